@@ -0,0 +1,71 @@
+#!/bin/sh
+# Сравнение strset_uniq с `sort -u` и `awk '!seen[$0]++'`.
+# strset_data1.txt размножается до SIZE_MB мегабайт, к строкам добавляется
+# номер из DISTINCT вариантов, чтобы уникальных строк было много.
+# Перед замерами вывод strset_uniq сверяется с awk (порядок первого
+# появления) и с `sort | uniq -c` (счетчики -c), при расхождении - выход
+# с ошибкой.
+#
+# ./bench_uniq.sh [SIZE_MB] [DISTINCT] [UNIQ]
+
+SIZE_MB=${1:-1024}
+DISTINCT=${2:-20000}
+UNIQ=${3:-./strset_uniq}
+DATA=${TMPDIR:-/tmp}/strset_uniq_bench.txt
+
+set -e
+
+if [ ! -f "$DATA" ] || [ "$(du -m "$DATA" | cut -f1)" -lt "$SIZE_MB" ]; then
+    echo "generating $DATA, $SIZE_MB MB"
+    awk -v size=$((SIZE_MB * 1024 * 1024)) -v distinct="$DISTINCT" '
+        { lines[n++] = $0 }
+        END {
+            srand(1)
+            while (written < size) {
+                line = lines[int(rand() * n)] " " int(rand() * distinct)
+                print line
+                written += length(line) + 1
+            }
+        }' strset_data1.txt > "$DATA"
+fi
+
+OUT=${TMPDIR:-/tmp}/strset_uniq_bench.out
+EXPECTED=${TMPDIR:-/tmp}/strset_uniq_bench.expected
+
+check() {
+    name=$1
+    if cmp -s "$OUT" "$EXPECTED"; then
+        echo "$name: output ok"
+    else
+        echo "$name: output differs, see $OUT and $EXPECTED"
+        exit 1
+    fi
+}
+
+awk '!seen[$0]++' < "$DATA" > "$EXPECTED"
+"$UNIQ" < "$DATA" > "$OUT"
+check "strset_uniq"
+"$UNIQ" -e hash64 < "$DATA" > "$OUT"
+check "strset_uniq -e hash64"
+
+# uniq -c печатает счетчик как "%7d ", так же как strset_uniq -c
+LC_ALL=C sort "$DATA" | uniq -c | LC_ALL=C sort > "$EXPECTED"
+"$UNIQ" -c < "$DATA" | LC_ALL=C sort > "$OUT"
+check "strset_uniq -c"
+rm -f "$OUT" "$EXPECTED"
+
+run() {
+    name=$1
+    shift
+    start=$(date +%s.%N)
+    "$@" < "$DATA" > /dev/null
+    end=$(date +%s.%N)
+    awk -v name="$name" -v s="$start" -v e="$end" -v mb="$SIZE_MB" \
+        'BEGIN { printf "%-24s %8.3fs %8.1f MB/s\n", name, e - s, mb / (e - s) }'
+}
+
+run "strset_uniq"           "$UNIQ"
+run "strset_uniq -e hash64" "$UNIQ" -e hash64
+run "strset_uniq -c"        "$UNIQ" -c
+run "awk !seen[\$0]++"      awk '!seen[$0]++'
+run "sort -u"               env LC_ALL=C sort -u
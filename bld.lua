@@ -6,5 +6,21 @@ return {
         artifact = "strset_test",
         main = "strset_test.c",
         src = "src",
-    }
+        -- у каждого артефакта свой main()
+        exclude = {
+            "strset_uniq.c",
+        },
+    },
+    {
+        not_dependencies = {
+            "lfs",
+        },
+        artifact = "strset_uniq",
+        main = "strset_uniq.c",
+        src = "src",
+        exclude = {
+            "strset_test.c",
+            "munit.c",
+        },
+    },
 }
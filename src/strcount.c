@@ -0,0 +1,145 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strcount.h"
+
+#include "strset_io.h"
+#include "strset_table.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct StrCount {
+    StrTable    table;
+    int64_t     total;
+};
+
+StrCount *strcount_new(struct StrSetSetup *setup) {
+    StrCount *cnt = calloc(1, sizeof(*cnt));
+    assert(cnt);
+    strtable_init(&cnt->table, setup, sizeof(int64_t));
+    return cnt;
+}
+
+void strcount_free(StrCount *cnt) {
+    if (!cnt)
+        return;
+    strtable_shutdown(&cnt->table);
+    free(cnt);
+}
+
+void strcount_clear(StrCount *cnt) {
+    assert(cnt);
+    strtable_clear(&cnt->table);
+    cnt->total = 0;
+}
+
+static int64_t count_inc(
+    StrCount *cnt, const char *key, size_t len, int64_t delta
+) {
+    int64_t *value = strtable_upsert(&cnt->table, key, len, NULL);
+    *value += delta;
+    cnt->total += delta;
+    return *value;
+}
+
+int64_t strcount_inc(StrCount *cnt, const char *key, int64_t delta) {
+    assert(cnt);
+    assert(key);
+    return count_inc(cnt, key, strlen(key), delta);
+}
+
+int64_t strcount_get(StrCount *cnt, const char *key) {
+    assert(cnt);
+    assert(key);
+    int64_t *value = strtable_get(&cnt->table, key, strlen(key));
+    return value ? *value : 0;
+}
+
+int64_t strcount_dec(StrCount *cnt, const char *key, int64_t delta) {
+    assert(cnt);
+    assert(key);
+
+    size_t len = strlen(key);
+    int64_t *value = strtable_get(&cnt->table, key, len);
+    if (!value)
+        return 0;
+
+    if (*value > delta) {
+        *value -= delta;
+        cnt->total -= delta;
+        return *value;
+    }
+
+    cnt->total -= *value;
+    strtable_remove(&cnt->table, key, len);
+    return 0;
+}
+
+bool strcount_exist(StrCount *cnt, const char *key) {
+    assert(cnt);
+    assert(key);
+    return strtable_get(&cnt->table, key, strlen(key));
+}
+
+void strcount_remove(StrCount *cnt, const char *key) {
+    assert(cnt);
+    assert(key);
+
+    size_t len = strlen(key);
+    int64_t *value = strtable_get(&cnt->table, key, len);
+    if (value) {
+        cnt->total -= *value;
+        strtable_remove(&cnt->table, key, len);
+    }
+}
+
+size_t strcount_count(StrCount *cnt) {
+    assert(cnt);
+    return cnt->table.count;
+}
+
+int64_t strcount_total(StrCount *cnt) {
+    assert(cnt);
+    return cnt->total;
+}
+
+struct EachCtx {
+    StrCount        *cnt;
+    StrSetAction    (*cb)(const char *key, int64_t count, void *udata);
+    void            *udata;
+};
+
+static StrSetAction iter_each(const char *key, void *value, void *udata) {
+    struct EachCtx *ctx = udata;
+    int64_t count = *(int64_t*)value;
+    StrSetAction action = ctx->cb(key, count, ctx->udata);
+    if (action == SSA_remove)
+        ctx->cnt->total -= count;
+    return action;
+}
+
+void strcount_each(
+    StrCount *cnt,
+    StrSetAction (*cb)(const char *key, int64_t count, void *udata),
+    void *udata
+) {
+    assert(cnt);
+    assert(cb);
+
+    strtable_each(&cnt->table, iter_each, &(struct EachCtx) {
+        .cnt = cnt,
+        .cb = cb,
+        .udata = udata,
+    });
+}
+
+static bool line_count(char *line, size_t len, void *udata) {
+    count_inc(udata, line, len, 1);
+    return true;
+}
+
+bool strcount_add_file(StrCount *cnt, const char *path, uint32_t flags) {
+    assert(cnt);
+    return strset_file_each_line(path, flags, line_count, cnt);
+}
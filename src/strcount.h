@@ -0,0 +1,38 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Мультимножество строк: ключ и число его повторов. strcount_inc() находит
+// или добавляет ключ за одну пробу таблицы. Ключ с числом <= 0 после
+// strcount_dec() удаляется.
+
+typedef struct StrCount StrCount;
+
+StrCount *strcount_new(struct StrSetSetup *setup);
+void strcount_free(StrCount *cnt);
+void strcount_clear(StrCount *cnt);
+// Возвращает новое значение. Ключ добавляется при первом вызове.
+int64_t strcount_inc(StrCount *cnt, const char *key, int64_t delta);
+// 0 для отсутствующего ключа
+int64_t strcount_get(StrCount *cnt, const char *key);
+// Возвращает остаток, при остатке <= 0 ключ удаляется и возвращается 0
+int64_t strcount_dec(StrCount *cnt, const char *key, int64_t delta);
+bool strcount_exist(StrCount *cnt, const char *key);
+void strcount_remove(StrCount *cnt, const char *key);
+// Число различных ключей
+size_t strcount_count(StrCount *cnt);
+// Сумма значений всех ключей
+int64_t strcount_total(StrCount *cnt);
+// SSA_remove удаляет ключ после обхода
+void strcount_each(
+    StrCount *cnt,
+    StrSetAction (*cb)(const char *key, int64_t count, void *udata),
+    void *udata
+);
+// Посчитать строки файла, flags - StrSetReadFlags из strset_io.h
+bool strcount_add_file(StrCount *cnt, const char *path, uint32_t flags);
@@ -0,0 +1,263 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strfilter.h"
+
+#include "strset_hash.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BUCKET_SLOTS    4
+#define MAX_KICKS       500
+#define LOAD_MAX        0.95
+
+struct StrFilter {
+    HashFunction    hasher;
+    int             bits;
+    uint64_t        fp_mask;
+    // bits * BUCKET_SLOTS
+    int             bucket_bits;
+    // по одной единице в младшем бите каждого слота и в старшем
+    uint64_t        ones, highs;
+
+    // корзины подряд по bucket_bits бит, в конце 8 байт запаса для
+    // чтения 64-битным словом
+    uint8_t         *table;
+    size_t          table_size;
+    // степень двойки
+    size_t          buckets_num;
+    size_t          count;
+    // для выбора выталкиваемого слота
+    uint64_t        rnd;
+
+    // отпечаток, которому не нашлось места, фильтр переполнен
+    bool            victim_used;
+    uint64_t        victim_fp;
+    size_t          victim_index;
+};
+
+// {{{ Корзины
+
+static inline uint64_t bucket_load(StrFilter *f, size_t index) {
+    size_t bit = index * f->bucket_bits;
+    uint64_t word;
+    memcpy(&word, f->table + bit / 8, sizeof(word));
+    word >>= bit % 8;
+    return f->bucket_bits == 64 ? word :
+        word & ((1ull << f->bucket_bits) - 1);
+}
+
+static inline void bucket_store(StrFilter *f, size_t index, uint64_t bucket) {
+    size_t bit = index * f->bucket_bits;
+    int shift = bit % 8;
+    uint64_t mask = f->bucket_bits == 64 ? ~0ull :
+        ((1ull << f->bucket_bits) - 1) << shift;
+    uint64_t word;
+    memcpy(&word, f->table + bit / 8, sizeof(word));
+    word = (word & ~mask) | (bucket << shift);
+    memcpy(f->table + bit / 8, &word, sizeof(word));
+}
+
+static inline uint64_t slot_get(StrFilter *f, uint64_t bucket, int slot) {
+    return (bucket >> (slot * f->bits)) & f->fp_mask;
+}
+
+static inline uint64_t slot_set(
+    StrFilter *f, uint64_t bucket, int slot, uint64_t fp
+) {
+    int shift = slot * f->bits;
+    return (bucket & ~(f->fp_mask << shift)) | (fp << shift);
+}
+
+// Есть ли fp в одном из слотов, без цикла по слотам
+static inline bool bucket_has(StrFilter *f, uint64_t bucket, uint64_t fp) {
+    uint64_t x = bucket ^ (fp * f->ones);
+    return (x - f->ones) & ~x & f->highs;
+}
+
+static int bucket_find(StrFilter *f, uint64_t bucket, uint64_t fp) {
+    for (int slot = 0; slot < BUCKET_SLOTS; slot++)
+        if (slot_get(f, bucket, slot) == fp)
+            return slot;
+    return -1;
+}
+
+// }}}
+
+static inline uint64_t rnd_next(StrFilter *f) {
+    f->rnd ^= f->rnd << 13;
+    f->rnd ^= f->rnd >> 7;
+    f->rnd ^= f->rnd << 17;
+    return f->rnd;
+}
+
+static inline size_t index_alt(StrFilter *f, size_t index, uint64_t fp) {
+    return (index ^ strset_hash_mix(fp)) & (f->buckets_num - 1);
+}
+
+// Отпечаток из старших бит хэша, никогда не 0 - это пустой слот
+static inline void key_hash(
+    StrFilter *f, const char *key, uint64_t *fp, size_t *index
+) {
+    uint64_t h = strset_hash_str(f->hasher, key);
+    *fp = (h >> (64 - f->bits)) & f->fp_mask;
+    if (!*fp)
+        *fp = 1;
+    *index = h & (f->buckets_num - 1);
+}
+
+StrFilter *strfilter_new(struct StrFilterSetup *setup) {
+    StrFilter *f = calloc(1, sizeof(*f));
+    assert(f);
+
+    f->hasher = strset_hasher_default(setup ? setup->hasher : NULL);
+    f->bits = setup && setup->fingerprint_bits ? setup->fingerprint_bits : 13;
+    assert(f->bits >= 4 && f->bits <= 16);
+    f->fp_mask = (1ull << f->bits) - 1;
+    f->bucket_bits = f->bits * BUCKET_SLOTS;
+    for (int slot = 0; slot < BUCKET_SLOTS; slot++)
+        f->ones |= 1ull << (slot * f->bits);
+    f->highs = f->ones << (f->bits - 1);
+
+    size_t capacity = setup && setup->capacity ? setup->capacity : 1024;
+    f->buckets_num = 1;
+    while (f->buckets_num * BUCKET_SLOTS * LOAD_MAX < capacity)
+        f->buckets_num *= 2;
+
+    f->table_size = (f->buckets_num * f->bucket_bits + 7) / 8 + 8;
+    f->table = calloc(f->table_size, 1);
+    assert(f->table);
+    f->rnd = 0x9e3779b97f4a7c15ull;
+    return f;
+}
+
+void strfilter_free(StrFilter *f) {
+    if (!f)
+        return;
+    free(f->table);
+    free(f);
+}
+
+void strfilter_clear(StrFilter *f) {
+    assert(f);
+    memset(f->table, 0, f->table_size);
+    f->count = 0;
+    f->victim_used = false;
+}
+
+static bool bucket_insert(StrFilter *f, size_t index, uint64_t fp) {
+    uint64_t bucket = bucket_load(f, index);
+    int slot = bucket_find(f, bucket, 0);
+    if (slot < 0)
+        return false;
+    bucket_store(f, index, slot_set(f, bucket, slot, fp));
+    return true;
+}
+
+bool strfilter_add(StrFilter *f, const char *key) {
+    assert(f);
+    assert(key);
+
+    if (f->victim_used)
+        return false;
+
+    uint64_t fp;
+    size_t index;
+    key_hash(f, key, &fp, &index);
+
+    size_t alt = index_alt(f, index, fp);
+    if (bucket_insert(f, index, fp) || bucket_insert(f, alt, fp)) {
+        f->count++;
+        return true;
+    }
+
+    // выталкивание случайного слота
+    index = rnd_next(f) & 1 ? alt : index;
+    for (int kick = 0; kick < MAX_KICKS; kick++) {
+        int slot = rnd_next(f) % BUCKET_SLOTS;
+        uint64_t bucket = bucket_load(f, index);
+        uint64_t evicted = slot_get(f, bucket, slot);
+        bucket_store(f, index, slot_set(f, bucket, slot, fp));
+
+        fp = evicted;
+        index = index_alt(f, index, fp);
+        if (bucket_insert(f, index, fp)) {
+            f->count++;
+            return true;
+        }
+    }
+
+    // ключ уже в таблице, без места остался вытолкнутый отпечаток
+    f->victim_used = true;
+    f->victim_fp = fp;
+    f->victim_index = index;
+    f->count++;
+    return true;
+}
+
+static bool victim_match(StrFilter *f, uint64_t fp, size_t index, size_t alt) {
+    return f->victim_used && f->victim_fp == fp &&
+        (f->victim_index == index || f->victim_index == alt);
+}
+
+bool strfilter_exist(StrFilter *f, const char *key) {
+    assert(f);
+    assert(key);
+
+    uint64_t fp;
+    size_t index;
+    key_hash(f, key, &fp, &index);
+    size_t alt = index_alt(f, index, fp);
+
+    return bucket_has(f, bucket_load(f, index), fp) ||
+           bucket_has(f, bucket_load(f, alt), fp) ||
+           victim_match(f, fp, index, alt);
+}
+
+static bool bucket_remove(StrFilter *f, size_t index, uint64_t fp) {
+    uint64_t bucket = bucket_load(f, index);
+    int slot = bucket_find(f, bucket, fp);
+    if (slot < 0)
+        return false;
+    bucket_store(f, index, slot_set(f, bucket, slot, 0));
+    return true;
+}
+
+bool strfilter_remove(StrFilter *f, const char *key) {
+    assert(f);
+    assert(key);
+
+    uint64_t fp;
+    size_t index;
+    key_hash(f, key, &fp, &index);
+    size_t alt = index_alt(f, index, fp);
+
+    if (victim_match(f, fp, index, alt)) {
+        f->victim_used = false;
+    } else if (bucket_remove(f, index, fp) || bucket_remove(f, alt, fp)) {
+        // освободилось место - попробовать вернуть вытолкнутый отпечаток
+        if (f->victim_used) {
+            size_t victim_alt = index_alt(f, f->victim_index, f->victim_fp);
+            if (bucket_insert(f, f->victim_index, f->victim_fp) ||
+                bucket_insert(f, victim_alt, f->victim_fp))
+                f->victim_used = false;
+        }
+    } else {
+        return false;
+    }
+
+    f->count--;
+    return true;
+}
+
+size_t strfilter_count(StrFilter *f) {
+    assert(f);
+    return f->count;
+}
+
+size_t strfilter_size(StrFilter *f) {
+    assert(f);
+    return f->table_size;
+}
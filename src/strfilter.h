@@ -0,0 +1,39 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Приблизительное множество строк - cuckoo фильтр. Хранятся только
+// отпечатки ключей по fingerprint_bits бит, 4 отпечатка в корзине, корзины
+// упакованы без выравнивания. Ложные срабатывания exist() - примерно
+// 8 / 2^fingerprint_bits, ложных отрицаний нет. Обхода ключей нет.
+//
+// Повторное добавление ключа кладет еще одну копию отпечатка, remove()
+// убирает одну копию. Удалять можно только добавленные ключи, иначе
+// может пропасть отпечаток другого ключа.
+
+struct StrFilterSetup {
+    // ожидаемое число ключей
+    size_t          capacity;
+    HashFunction    hasher;
+    // от 4 до 16, 0 - 13 бит (около 0.1% ложных срабатываний, меньше 2
+    // байт на ключ при заполнении 95%)
+    int             fingerprint_bits;
+};
+
+typedef struct StrFilter StrFilter;
+
+StrFilter *strfilter_new(struct StrFilterSetup *setup);
+void strfilter_free(StrFilter *filter);
+void strfilter_clear(StrFilter *filter);
+// false - фильтр переполнен, ключ не добавлен
+bool strfilter_add(StrFilter *filter, const char *key);
+bool strfilter_exist(StrFilter *filter, const char *key);
+// false - отпечатка ключа нет
+bool strfilter_remove(StrFilter *filter, const char *key);
+size_t strfilter_count(StrFilter *filter);
+// Размер таблицы в байтах
+size_t strfilter_size(StrFilter *filter);
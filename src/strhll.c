@@ -0,0 +1,158 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strhll.h"
+
+#include "strset_hash.h"
+#include "strset_io.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define PRECISION_DEFAULT   14
+
+struct StrHLL {
+    HashFunction    hasher;
+    int             p;
+    // 2^p регистров, в каждом максимальный ранг
+    size_t          m;
+    uint8_t         *regs;
+};
+
+StrHLL *strhll_new(int precision, HashFunction hasher) {
+    StrHLL *hll = calloc(1, sizeof(*hll));
+    assert(hll);
+
+    hll->p = precision ? precision : PRECISION_DEFAULT;
+    assert(hll->p >= 4 && hll->p <= 18);
+    hll->m = (size_t)1 << hll->p;
+    hll->hasher = strset_hasher_default(hasher);
+    hll->regs = calloc(hll->m, sizeof(hll->regs[0]));
+    assert(hll->regs);
+    return hll;
+}
+
+void strhll_free(StrHLL *hll) {
+    if (!hll)
+        return;
+    free(hll->regs);
+    free(hll);
+}
+
+void strhll_clear(StrHLL *hll) {
+    assert(hll);
+    memset(hll->regs, 0, hll->m);
+}
+
+void strhll_add_len(StrHLL *hll, const char *key, size_t len) {
+    assert(hll);
+    assert(key);
+
+    uint64_t h = strset_hash(hll->hasher, key, len);
+    size_t index = h >> (64 - hll->p);
+    // ранг - позиция первой единицы в оставшихся 64 - p битах
+    uint64_t w = h << hll->p;
+    int q = 64 - hll->p;
+    uint8_t rank = w ? __builtin_clzll(w) + 1 : q + 1;
+    if (rank > q + 1)
+        rank = q + 1;
+    if (hll->regs[index] < rank)
+        hll->regs[index] = rank;
+}
+
+void strhll_add(StrHLL *hll, const char *key) {
+    assert(key);
+    strhll_add_len(hll, key, strlen(key));
+}
+
+bool strhll_merge(StrHLL *dst, StrHLL *src) {
+    assert(dst);
+    assert(src);
+    if (dst->p != src->p || dst->hasher != src->hasher)
+        return false;
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    // m >= 16
+    for (; i + 16 <= dst->m; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst->regs + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src->regs + i));
+        _mm_storeu_si128((__m128i*)(dst->regs + i), _mm_max_epu8(a, b));
+    }
+#endif
+    for (; i < dst->m; i++)
+        if (dst->regs[i] < src->regs[i])
+            dst->regs[i] = src->regs[i];
+    return true;
+}
+
+// {{{ Оценка (O. Ertl, New cardinality estimation algorithms for
+// HyperLogLog sketches, 2017)
+
+static double sigma(double x) {
+    if (x == 1.)
+        return INFINITY;
+    double y = 1., z = x, z_prev;
+    do {
+        x *= x;
+        z_prev = z;
+        z += x * y;
+        y += y;
+    } while (z != z_prev);
+    return z;
+}
+
+static double tau(double x) {
+    if (x == 0. || x == 1.)
+        return 0.;
+    double y = 1., z = 1. - x, z_prev;
+    do {
+        x = sqrt(x);
+        z_prev = z;
+        y *= 0.5;
+        z -= (1. - x) * (1. - x) * y;
+    } while (z != z_prev);
+    return z / 3.;
+}
+
+double strhll_estimate(StrHLL *hll) {
+    assert(hll);
+
+    int q = 64 - hll->p;
+    // гистограмма значений регистров
+    size_t counts[66] = {};
+    for (size_t i = 0; i < hll->m; i++)
+        counts[hll->regs[i]]++;
+
+    double m = hll->m;
+    double z = m * tau(1. - counts[q + 1] / m);
+    for (int k = q; k >= 1; k--)
+        z = 0.5 * (z + counts[k]);
+    z += m * sigma(counts[0] / m);
+    return m * m / (2. * log(2.)) / z;
+}
+
+// }}}
+
+static bool line_add(char *line, size_t len, void *udata) {
+    strhll_add_len(udata, line, len);
+    return true;
+}
+
+double strhll_estimate_file(
+    const char *path, uint32_t flags, int precision, HashFunction hasher
+) {
+    assert(path);
+
+    StrHLL *hll = strhll_new(precision, hasher);
+    double estimate = -1.;
+    if (strset_file_each_line(path, flags, line_add, hll))
+        estimate = strhll_estimate(hll);
+    strhll_free(hll);
+    return estimate;
+}
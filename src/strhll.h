@@ -0,0 +1,31 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// HyperLogLog - оценка числа различных ключей в потоке за 2^precision байт.
+// Стандартная ошибка около 1.04 / sqrt(2^precision): 0.8% при precision 14.
+// Оценка по гистограмме регистров методом Ertl без таблиц поправок, точна
+// и на малом, и на большом числе ключей.
+
+typedef struct StrHLL StrHLL;
+
+// precision от 4 до 18, 0 - 14. hasher NULL - первая из koh_hashers.
+StrHLL *strhll_new(int precision, HashFunction hasher);
+void strhll_free(StrHLL *hll);
+void strhll_clear(StrHLL *hll);
+void strhll_add(StrHLL *hll, const char *key);
+void strhll_add_len(StrHLL *hll, const char *key, size_t len);
+// dst = dst U src. false если у скетчей разные precision или hasher.
+bool strhll_merge(StrHLL *dst, StrHLL *src);
+double strhll_estimate(StrHLL *hll);
+
+// Оценка числа различных строк файла, flags - StrSetReadFlags из
+// strset_io.h. Отрицательное значение при ошибке чтения.
+double strhll_estimate_file(
+    const char *path, uint32_t flags, int precision, HashFunction hasher
+);
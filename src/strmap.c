@@ -0,0 +1,85 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strmap.h"
+
+#include "strset_table.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct StrMap {
+    StrTable    table;
+};
+
+StrMap *strmap_new(struct StrMapSetup *setup) {
+    StrMap *map = calloc(1, sizeof(*map));
+    assert(map);
+    size_t value_size = setup && setup->value_size ?
+        setup->value_size : sizeof(void*);
+    strtable_init(&map->table, setup ? &setup->set : NULL, value_size);
+    return map;
+}
+
+void strmap_free(StrMap *map) {
+    if (!map)
+        return;
+    strtable_shutdown(&map->table);
+    free(map);
+}
+
+void strmap_clear(StrMap *map) {
+    assert(map);
+    strtable_clear(&map->table);
+}
+
+void *strmap_get(StrMap *map, const char *key) {
+    assert(map);
+    assert(key);
+    return strtable_get(&map->table, key, strlen(key));
+}
+
+void strmap_put(StrMap *map, const char *key, const void *value) {
+    assert(map);
+    assert(key);
+    assert(value);
+    void *slot = strtable_upsert(&map->table, key, strlen(key), NULL);
+    memcpy(slot, value, map->table.value_size);
+}
+
+void *strmap_get_or_insert(StrMap *map, const char *key, bool *inserted) {
+    assert(map);
+    assert(key);
+    return strtable_upsert(&map->table, key, strlen(key), inserted);
+}
+
+bool strmap_remove(StrMap *map, const char *key) {
+    assert(map);
+    assert(key);
+    return strtable_remove(&map->table, key, strlen(key));
+}
+
+size_t strmap_count(StrMap *map) {
+    assert(map);
+    return map->table.count;
+}
+
+void strmap_each(
+    StrMap *map,
+    StrSetAction (*cb)(const char *key, void *value, void *udata),
+    void *udata
+) {
+    assert(map);
+    strtable_each(&map->table, cb, udata);
+}
+
+void strmap_put_ptr(StrMap *map, const char *key, void *ptr) {
+    assert(map->table.value_size == sizeof(ptr));
+    strmap_put(map, key, &ptr);
+}
+
+void *strmap_get_ptr(StrMap *map, const char *key) {
+    assert(map->table.value_size == sizeof(void*));
+    void **slot = strmap_get(map, key);
+    return slot ? *slot : NULL;
+}
@@ -0,0 +1,45 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Отображение строки в значение фиксированного размера (или указатель).
+// Значения лежат прямо в слотах таблицы рядом с ключом, ключи копируются в
+// арену. Указатели на значения действительны до следующего добавления или
+// удаления. Значение выровнено по наибольшей степени двойки, на которую
+// делится value_size, но не больше _Alignof(max_align_t): long double и
+// векторные типы SSE размером 16 байт выровнены правильно.
+
+struct StrMapSetup {
+    struct StrSetSetup  set;
+    // 0 - sizeof(void*)
+    size_t              value_size;
+};
+
+typedef struct StrMap StrMap;
+
+StrMap *strmap_new(struct StrMapSetup *setup);
+void strmap_free(StrMap *map);
+void strmap_clear(StrMap *map);
+// NULL если ключа нет
+void *strmap_get(StrMap *map, const char *key);
+// Копирует value_size байт из value
+void strmap_put(StrMap *map, const char *key, const void *value);
+// Слот значения за одну пробу, новый ключ получает нулевое значение.
+// inserted может быть NULL.
+void *strmap_get_or_insert(StrMap *map, const char *key, bool *inserted);
+bool strmap_remove(StrMap *map, const char *key);
+size_t strmap_count(StrMap *map);
+// SSA_remove удаляет ключ после обхода
+void strmap_each(
+    StrMap *map,
+    StrSetAction (*cb)(const char *key, void *value, void *udata),
+    void *udata
+);
+
+// Для значений-указателей
+void strmap_put_ptr(StrMap *map, const char *key, void *ptr);
+void *strmap_get_ptr(StrMap *map, const char *key);
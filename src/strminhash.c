@@ -0,0 +1,116 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strminhash.h"
+
+#include "strset_hash.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define K_DEFAULT   128
+
+struct StrMinHash {
+    HashFunction    hasher;
+    int             k, num;
+    // по возрастанию, без повторов
+    uint64_t        *mins;
+};
+
+StrMinHash *strminhash_new(int k, HashFunction hasher) {
+    StrMinHash *mh = calloc(1, sizeof(*mh));
+    assert(mh);
+
+    mh->k = k > 0 ? k : K_DEFAULT;
+    mh->hasher = strset_hasher_default(hasher);
+    mh->mins = calloc(mh->k, sizeof(mh->mins[0]));
+    assert(mh->mins);
+    return mh;
+}
+
+void strminhash_free(StrMinHash *mh) {
+    if (!mh)
+        return;
+    free(mh->mins);
+    free(mh);
+}
+
+void strminhash_clear(StrMinHash *mh) {
+    assert(mh);
+    mh->num = 0;
+}
+
+void strminhash_add_hash(StrMinHash *mh, uint64_t hash) {
+    assert(mh);
+
+    // частый случай для большого набора - хэш больше всех в подписи
+    if (mh->num == mh->k && hash >= mh->mins[mh->num - 1])
+        return;
+
+    // первый элемент не меньше hash
+    int lo = 0, hi = mh->num;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (mh->mins[mid] < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < mh->num && mh->mins[lo] == hash)
+        return;
+
+    int tail = mh->num - lo - (mh->num == mh->k);
+    memmove(&mh->mins[lo + 1], &mh->mins[lo], sizeof(mh->mins[0]) * tail);
+    mh->mins[lo] = hash;
+    if (mh->num < mh->k)
+        mh->num++;
+}
+
+void strminhash_add(StrMinHash *mh, const char *key) {
+    assert(mh);
+    assert(key);
+    strminhash_add_hash(mh, strset_hash_str(mh->hasher, key));
+}
+
+int strminhash_num(StrMinHash *mh) {
+    assert(mh);
+    return mh->num;
+}
+
+static StrSetAction iter_add(const char *key, void *udata) {
+    strminhash_add(udata, key);
+    return SSA_next;
+}
+
+StrMinHash *strset_minhash(StrSet *set, int k, HashFunction hasher) {
+    assert(set);
+    StrMinHash *mh = strminhash_new(k, hasher);
+    strset_each(set, iter_add, mh);
+    return mh;
+}
+
+double strminhash_jaccard(StrMinHash *a, StrMinHash *b) {
+    assert(a);
+    assert(b);
+    if (a->k != b->k || a->hasher != b->hasher)
+        return -1.;
+    if (!a->num && !b->num)
+        return 1.;
+
+    // k наименьших хэшей объединения и сколько из них есть в обеих
+    // подписях. Подпись короче k содержит все хэши своего набора.
+    int i = 0, j = 0, taken = 0, both = 0;
+    while (taken < a->k && (i < a->num || j < b->num)) {
+        if (j == b->num || (i < a->num && a->mins[i] < b->mins[j])) {
+            i++;
+        } else if (i == a->num || b->mins[j] < a->mins[i]) {
+            j++;
+        } else {
+            both++;
+            i++;
+            j++;
+        }
+        taken++;
+    }
+    return (double)both / taken;
+}
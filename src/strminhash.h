@@ -0,0 +1,32 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include "koh_strset.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Подпись набора для оценки сходства Жаккара |A & B| / |A | B| без обхода
+// обоих наборов: k наименьших хэшей ключей (bottom-k MinHash). Ошибка
+// оценки около sqrt(J * (1 - J) / k), для наборов меньше k ключей оценка
+// точная. Подпись только растет, удаление ключа не поддерживается.
+
+typedef struct StrMinHash StrMinHash;
+
+// k == 0 - 128. hasher NULL - первая из koh_hashers.
+StrMinHash *strminhash_new(int k, HashFunction hasher);
+void strminhash_free(StrMinHash *mh);
+void strminhash_clear(StrMinHash *mh);
+void strminhash_add(StrMinHash *mh, const char *key);
+// hash - strset_hash_str() с тем же hasher
+void strminhash_add_hash(StrMinHash *mh, uint64_t hash);
+// Сколько хэшей в подписи, не больше k
+int strminhash_num(StrMinHash *mh);
+
+// Подпись по всем ключам набора
+StrMinHash *strset_minhash(StrSet *set, int k, HashFunction hasher);
+
+// Оценка сходства от 0 до 1. Отрицательное значение, если у подписей
+// разные k или hasher.
+double strminhash_jaccard(StrMinHash *a, StrMinHash *b);
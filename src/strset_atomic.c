@@ -0,0 +1,373 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_atomic.h"
+
+#include "strset_hash.h"
+#include <assert.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define cpu_relax() _mm_pause()
+#else
+#define cpu_relax()
+#endif
+
+#define CAPACITY_MIN    64
+#define MIGRATE_CHUNK   1024
+#define COUNT_STRIPES   64
+// как часто поток сверяет заполнение таблицы
+#define COUNT_CHECK     64
+// пробирование длиннее этого тоже повод проверить заполнение
+#define PROBE_LONG      16
+// ожидание другого потока: столько пауз, потом sched_yield()
+#define SPIN_MAX        64
+
+// tag == 0 - пустой слот, иначе хэш с установленным младшим битом или
+// TAG_MOVED. Младший бит только признак занятого слота, домашний слот
+// берется из остальных бит хэша.
+#define TAG_MOVED       2
+
+struct Slot {
+    _Atomic uint64_t    tag;
+    _Atomic(char*)      key;
+};
+
+// Таблица с состоянием своего переноса в следующую. Перенесенный слот
+// помечается TAG_MOVED, встретивший его поток помогает закончить перенос
+// и продолжает в next.
+struct Table {
+    struct Slot             *slots;
+    size_t                  cap, mask;
+    _Atomic(struct Table*)  next;
+    // pos - следующий кусок для переноса, done - перенесено слотов,
+    // finished - next опубликована в StrSetAtomic.table
+    _Atomic size_t          pos, done;
+    _Atomic bool            finished;
+    // старые таблицы живут до strset_atomic_free(), их могут читать
+    struct Table            *retired;
+};
+
+// Счетчик на своей строке кэша, каждый поток пишет в свою полосу
+struct Stripe {
+    _Atomic size_t  n;
+} __attribute__((aligned(64)));
+
+struct StrSetAtomic {
+    _Atomic(struct Table*)  table;
+    HashFunction            hasher;
+    struct Stripe           stripes[COUNT_STRIPES];
+};
+
+static _Atomic size_t           stripe_next;
+static _Thread_local size_t     stripe_self = SIZE_MAX;
+
+static struct Table *table_new(size_t cap) {
+    struct Table *t = calloc(1, sizeof(*t));
+    assert(t);
+    t->cap = cap;
+    t->mask = cap - 1;
+    t->slots = calloc(cap, sizeof(t->slots[0]));
+    assert(t->slots);
+    return t;
+}
+
+static inline uint64_t tag_make(uint64_t h) {
+    return h | 1;
+}
+
+static inline size_t tag_home(struct Table *t, uint64_t tag) {
+    return (tag >> 1) & t->mask;
+}
+
+// Ждущий поток уступает процессор, если тот, кого он ждет, вытеснен
+static inline void backoff(int *spins) {
+    if (++*spins < SPIN_MAX)
+        cpu_relax();
+    else
+        sched_yield();
+}
+
+// Слот уже захвачен, но ключ может быть еще не опубликован
+static inline char *slot_key_wait(struct Slot *slot) {
+    char *key;
+    int spins = 0;
+    while (!(key = atomic_load_explicit(&slot->key, memory_order_acquire)))
+        backoff(&spins);
+    return key;
+}
+
+// {{{ Перенос
+
+// Перенос без проверки дубликатов: ключи в старой таблице уникальны, а в
+// next до конца переноса никто кроме переносящих не пишет
+static void table_move(struct Table *t, uint64_t tag, char *key) {
+    for (size_t j = tag_home(t, tag);; j = (j + 1) & t->mask) {
+        struct Slot *slot = &t->slots[j];
+        uint64_t empty = 0;
+        if (atomic_compare_exchange_strong_explicit(
+            &slot->tag, &empty, tag,
+            memory_order_relaxed, memory_order_relaxed
+        )) {
+            atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+static void migrate_chunk(struct Table *t, size_t pos, size_t end) {
+    struct Table *next = atomic_load(&t->next);
+    for (size_t i = pos; i < end; i++) {
+        struct Slot *slot = &t->slots[i];
+        uint64_t tag = 0;
+        // пустой слот закрывается сразу, писатель увидит TAG_MOVED
+        if (atomic_compare_exchange_strong(&slot->tag, &tag, TAG_MOVED))
+            continue;
+        table_move(next, tag, slot_key_wait(slot));
+        atomic_store(&slot->tag, TAG_MOVED);
+    }
+}
+
+// Перенести свободные куски t и дождаться чужих. Возвращает таблицу, в
+// которой надо продолжать.
+static struct Table *migrate_help(StrSetAtomic *set, struct Table *t) {
+    for (;;) {
+        size_t pos = atomic_fetch_add(&t->pos, MIGRATE_CHUNK);
+        if (pos >= t->cap)
+            break;
+
+        size_t end = pos + MIGRATE_CHUNK < t->cap ? pos + MIGRATE_CHUNK : t->cap;
+        migrate_chunk(t, pos, end);
+        if (atomic_fetch_add(&t->done, end - pos) + (end - pos) == t->cap) {
+            struct Table *next = atomic_load(&t->next);
+            next->retired = t;
+            atomic_store(&set->table, next);
+            atomic_store(&t->finished, true);
+        }
+    }
+
+    // Куски разобраны, остались уже взятые другими потоками. Пока next не
+    // опубликована, в нее никто не пишет и ее перенос не начнется.
+    int spins = 0;
+    while (!atomic_load(&t->finished))
+        backoff(&spins);
+    return atomic_load(&t->next);
+}
+
+// Начать перенос t, если его еще никто не начал, и помочь
+static struct Table *migrate_start(StrSetAtomic *set, struct Table *t) {
+    if (!atomic_load(&t->next)) {
+        struct Table *next = table_new(t->cap * 2), *expected = NULL;
+        if (!atomic_compare_exchange_strong(&t->next, &expected, next)) {
+            free(next->slots);
+            free(next);
+        }
+    }
+    return migrate_help(set, t);
+}
+
+// }}}
+
+// {{{ Счетчик
+
+static struct Stripe *stripe_get(StrSetAtomic *set) {
+    if (stripe_self == SIZE_MAX)
+        stripe_self = atomic_fetch_add(&stripe_next, 1) % COUNT_STRIPES;
+    return &set->stripes[stripe_self];
+}
+
+static size_t count_sum(StrSetAtomic *set) {
+    size_t count = 0;
+    for (int i = 0; i < COUNT_STRIPES; i++)
+        count += atomic_load_explicit(&set->stripes[i].n, memory_order_relaxed);
+    return count;
+}
+
+// }}}
+
+StrSetAtomic *strset_atomic_new(struct StrSetSetup *setup) {
+    StrSetAtomic *set = aligned_alloc(64, sizeof(*set));
+    assert(set);
+    memset(set, 0, sizeof(*set));
+
+    size_t cap = CAPACITY_MIN;
+    while (setup && cap < setup->capacity * 2)
+        cap *= 2;
+
+    set->hasher = strset_hasher_default(setup ? setup->hasher : NULL);
+    atomic_init(&set->table, table_new(cap));
+    return set;
+}
+
+void strset_atomic_free(StrSetAtomic *set) {
+    if (!set)
+        return;
+
+    // ключи принадлежат текущей таблице, в старых они перенесены
+    struct Table *t = atomic_load(&set->table);
+    for (size_t i = 0; i < t->cap; i++)
+        free(atomic_load_explicit(&t->slots[i].key, memory_order_relaxed));
+
+    while (t) {
+        struct Table *retired = t->retired;
+        free(t->slots);
+        free(t);
+        t = retired;
+    }
+    free(set);
+}
+
+enum ProbeResult {
+    IR_added,
+    IR_exist,
+    IR_moved,
+    IR_full,
+    IR_missing,
+};
+
+// copy - заранее сделанная копия ключа, забирается при добавлении, чтобы
+// между захватом слота и публикацией ключа не было malloc()
+static enum ProbeResult table_insert(
+    struct Table *t, uint64_t tag, const char *key, char **copy,
+    size_t *probes
+) {
+    size_t j = tag_home(t, tag);
+    for (size_t i = 0; i < t->cap; i++, j = (j + 1) & t->mask) {
+        struct Slot *slot = &t->slots[j];
+        uint64_t slot_tag = atomic_load_explicit(
+            &slot->tag, memory_order_acquire
+        );
+
+        if (!slot_tag) {
+            if (!*copy) {
+                *copy = strdup(key);
+                assert(*copy);
+            }
+            if (atomic_compare_exchange_strong_explicit(
+                &slot->tag, &slot_tag, tag,
+                memory_order_acq_rel, memory_order_acquire
+            )) {
+                atomic_store_explicit(&slot->key, *copy, memory_order_release);
+                *copy = NULL;
+                *probes = i;
+                return IR_added;
+            }
+            // слот занял другой поток или перенос, slot_tag теперь его тег
+        }
+
+        if (slot_tag == TAG_MOVED)
+            return IR_moved;
+        if (slot_tag == tag && !strcmp(slot_key_wait(slot), key))
+            return IR_exist;
+    }
+    return IR_full;
+}
+
+bool strset_atomic_add(StrSetAtomic *set, const char *key) {
+    assert(set);
+    assert(key);
+
+    uint64_t tag = tag_make(strset_hash_str(set->hasher, key));
+    struct Table *t = atomic_load(&set->table);
+    char *copy = NULL;
+    size_t probes = 0;
+
+    for (;;) {
+        switch (table_insert(t, tag, key, &copy, &probes)) {
+            case IR_exist:
+                free(copy);
+                return false;
+            case IR_moved:
+                t = migrate_help(set, t);
+                continue;
+            case IR_full:
+                t = migrate_start(set, t);
+                continue;
+            case IR_missing:
+                // table_insert() так не отвечает
+                assert(0);
+                continue;
+            case IR_added: {
+                size_t n = atomic_fetch_add_explicit(
+                    &stripe_get(set)->n, 1, memory_order_relaxed
+                ) + 1;
+                if ((n % COUNT_CHECK == 0 || probes > PROBE_LONG) &&
+                    count_sum(set) > t->cap / 2)
+                    migrate_start(set, t);
+                return true;
+            }
+        }
+    }
+}
+
+// Поиск без ожидания других потоков. Перенесенный слот не прерывает
+// цепочку: ключ может лежать дальше в еще не перенесенном слоте. Ключ из
+// перенесенного слота уже записан в next до метки TAG_MOVED. Слот с еще не
+// опубликованным ключом пропускается, его добавление не завершено.
+static enum ProbeResult table_find(
+    struct Table *t, uint64_t tag, const char *key
+) {
+    bool moved = false;
+    size_t j = tag_home(t, tag);
+    for (size_t i = 0; i < t->cap; i++, j = (j + 1) & t->mask) {
+        struct Slot *slot = &t->slots[j];
+        uint64_t slot_tag = atomic_load_explicit(
+            &slot->tag, memory_order_acquire
+        );
+        if (!slot_tag)
+            break;
+        if (slot_tag == TAG_MOVED) {
+            moved = true;
+            continue;
+        }
+        if (slot_tag != tag)
+            continue;
+        const char *slot_key = atomic_load_explicit(
+            &slot->key, memory_order_acquire
+        );
+        if (slot_key && !strcmp(slot_key, key))
+            return IR_exist;
+    }
+    return moved ? IR_moved : IR_missing;
+}
+
+bool strset_atomic_exist(StrSetAtomic *set, const char *key) {
+    assert(set);
+    assert(key);
+
+    uint64_t tag = tag_make(strset_hash_str(set->hasher, key));
+    struct Table *t = atomic_load(&set->table);
+    enum ProbeResult res;
+    while ((res = table_find(t, tag, key)) == IR_moved)
+        t = atomic_load(&t->next);
+    return res == IR_exist;
+}
+
+size_t strset_atomic_count(StrSetAtomic *set) {
+    assert(set);
+    return count_sum(set);
+}
+
+void strset_atomic_each(
+    StrSetAtomic *set, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+) {
+    assert(set);
+    assert(cb);
+
+    struct Table *t = atomic_load(&set->table);
+    for (size_t i = 0; i < t->cap; i++) {
+        struct Slot *slot = &t->slots[i];
+        uint64_t tag = atomic_load_explicit(&slot->tag, memory_order_acquire);
+        if (!tag || tag == TAG_MOVED)
+            continue;
+        StrSetAction action = cb(slot_key_wait(slot), udata);
+        assert(action != SSA_remove);
+        (void)action;
+    }
+}
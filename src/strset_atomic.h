@@ -0,0 +1,39 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Набор только на добавление без мьютексов: слот захватывается CAS по слову
+// хэша, ключ публикуется отдельной release записью. Число ключей считается
+// по полосам на поток, общего счетчика нет. Удаления нет.
+//
+// strset_atomic_exist() никогда не ждет другие потоки: перенесенные слоты
+// ведут в следующую таблицу, неопубликованный ключ считается еще не
+// добавленным.
+//
+// strset_atomic_add() не lock-free во время расширения. Расширение
+// блокирующее и совместное: добавляющий поток, встретивший перенесенный
+// слот, переносит свободные куски таблицы и ждет, пока другие потоки
+// закончат взятые куски. Вытесненный переносящий поток задерживает
+// добавления, но не поиск. Вне расширения добавление ждет только
+// публикации ключа в слоте с тем же хэшем.
+
+typedef struct StrSetAtomic StrSetAtomic;
+
+StrSetAtomic *strset_atomic_new(struct StrSetSetup *setup);
+// Не потокобезопасно, вызывать когда все потоки закончили работу
+void strset_atomic_free(StrSetAtomic *set);
+// Возвращает true если ключ был добавлен этим вызовом
+bool strset_atomic_add(StrSetAtomic *set, const char *key);
+bool strset_atomic_exist(StrSetAtomic *set, const char *key);
+size_t strset_atomic_count(StrSetAtomic *set);
+// Обход текущей таблицы. Верен только когда никто не добавляет: во время
+// расширения ключи из перенесенных слотов пропускаются. SSA_remove не
+// поддерживается.
+void strset_atomic_each(
+    StrSetAtomic *set, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+);
@@ -0,0 +1,110 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_bloom.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define BLOCK_WORDS 8
+
+typedef struct Block {
+    uint32_t    words[BLOCK_WORDS];
+} __attribute__((aligned(32))) Block;
+
+struct StrSetBloom {
+    Block   *blocks;
+    // степень двойки
+    size_t  blocks_num;
+    size_t  capacity;
+};
+
+// Нечетные множители для номера бита в каждом слове блока
+static const uint32_t salts[BLOCK_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+StrSetBloom *strset_bloom_new(size_t keys_num, int bits_per_key) {
+    StrSetBloom *bloom = calloc(1, sizeof(*bloom));
+    assert(bloom);
+
+    if (bits_per_key <= 0)
+        bits_per_key = 16;
+    if (!keys_num)
+        keys_num = 1;
+
+    size_t bits = keys_num * bits_per_key;
+    bloom->blocks_num = 1;
+    while (bloom->blocks_num * sizeof(Block) * 8 < bits)
+        bloom->blocks_num *= 2;
+    bloom->capacity = bloom->blocks_num * sizeof(Block) * 8 / bits_per_key;
+
+    // блок не пересекает границу кэш-линии
+    bloom->blocks = aligned_alloc(sizeof(Block), bloom->blocks_num * sizeof(Block));
+    assert(bloom->blocks);
+    strset_bloom_clear(bloom);
+    return bloom;
+}
+
+void strset_bloom_free(StrSetBloom *bloom) {
+    if (!bloom)
+        return;
+    free(bloom->blocks);
+    free(bloom);
+}
+
+void strset_bloom_clear(StrSetBloom *bloom) {
+    assert(bloom);
+    memset(bloom->blocks, 0, bloom->blocks_num * sizeof(Block));
+}
+
+// Блок по старшим битам, биты внутри блока по младшим
+static inline Block *block_get(StrSetBloom *bloom, uint64_t hash) {
+    return &bloom->blocks[(hash >> 32) & (bloom->blocks_num - 1)];
+}
+
+void strset_bloom_add(StrSetBloom *bloom, uint64_t hash) {
+    assert(bloom);
+    Block *block = block_get(bloom, hash);
+    uint32_t key = (uint32_t)hash;
+    for (int i = 0; i < BLOCK_WORDS; i++)
+        block->words[i] |= 1u << ((key * salts[i]) >> 27);
+}
+
+bool strset_bloom_maybe(StrSetBloom *bloom, uint64_t hash) {
+    assert(bloom);
+    Block *block = block_get(bloom, hash);
+    uint32_t key = (uint32_t)hash;
+
+#if defined(__AVX2__)
+    __m256i salt = _mm256_loadu_si256((const __m256i*)salts);
+    __m256i shift = _mm256_srli_epi32(
+        _mm256_mullo_epi32(_mm256_set1_epi32(key), salt), 27
+    );
+    __m256i mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), shift);
+    __m256i words = _mm256_load_si256((const __m256i*)block->words);
+    // все биты маски есть в блоке
+    return _mm256_testc_si256(words, mask);
+#else
+    for (int i = 0; i < BLOCK_WORDS; i++)
+        if (!(block->words[i] & (1u << ((key * salts[i]) >> 27))))
+            return false;
+    return true;
+#endif
+}
+
+size_t strset_bloom_capacity(StrSetBloom *bloom) {
+    assert(bloom);
+    return bloom->capacity;
+}
+
+size_t strset_bloom_size(StrSetBloom *bloom) {
+    assert(bloom);
+    return bloom->blocks_num * sizeof(Block);
+}
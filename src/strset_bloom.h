@@ -0,0 +1,26 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Блочный фильтр Блума (split block): ключ попадает в один блок из 8
+// 32-битных слов, в каждом слове ставится по одному биту. Проверка читает
+// одну кэш-линию. Ложных отрицаний нет, ложных срабатываний - доли
+// процента при 16 битах на ключ. Удаления нет.
+// На вход подается 64-битный хэш ключа, например strset_hash_str().
+
+typedef struct StrSetBloom StrSetBloom;
+
+// keys_num - ожидаемое число ключей, bits_per_key == 0 - 16 бит
+StrSetBloom *strset_bloom_new(size_t keys_num, int bits_per_key);
+void strset_bloom_free(StrSetBloom *bloom);
+void strset_bloom_clear(StrSetBloom *bloom);
+void strset_bloom_add(StrSetBloom *bloom, uint64_t hash);
+// false - ключа точно нет
+bool strset_bloom_maybe(StrSetBloom *bloom, uint64_t hash);
+// Число ключей, на которое рассчитан фильтр
+size_t strset_bloom_capacity(StrSetBloom *bloom);
+size_t strset_bloom_size(StrSetBloom *bloom);
@@ -0,0 +1,388 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_ext.h"
+
+#include "strset_bloom.h"
+#include "strset_hash.h"
+#include "strset_table.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOOM_KEYS_MIN      1024
+
+struct StrSetExt {
+    StrSet          *set;
+    HashFunction    hasher;
+    uint32_t        flags;
+    uint64_t        fingerprint;
+
+    // SSX_dense: ключи в порядке добавления. Удаленные ключи остаются в
+    // массиве до сжатия, dense_removed - сколько их.
+    const char      **dense;
+    size_t          dense_num, dense_cap, dense_removed;
+    StrArena        arena;
+
+    // без SSX_dense: указатели на ключи StrSet для итератора
+    const char      **snapshot;
+    size_t          snapshot_num;
+
+    // SSX_bloom: удаленные ключи остаются в фильтре до пересборки
+    StrSetBloom     *bloom;
+    size_t          bloom_removed;
+
+    // SSX_minhash
+    StrMinHash      *minhash;
+    bool            minhash_stale;
+};
+
+// {{{ Плотный массив
+
+static void dense_push(StrSetExt *ext, const char *key) {
+    if (ext->dense_num == ext->dense_cap) {
+        ext->dense_cap = ext->dense_cap ? ext->dense_cap * 2 : 256;
+        ext->dense = realloc(ext->dense, sizeof(ext->dense[0]) * ext->dense_cap);
+        assert(ext->dense);
+    }
+    ext->dense[ext->dense_num++] = strarena_strdup(
+        &ext->arena, key, strlen(key)
+    );
+}
+
+// Убрать удаленные ключи. Ключ, удаленный и добавленный заново, лежит в
+// массиве дважды, остается последнее вхождение.
+static void dense_compact(StrSetExt *ext) {
+    if (!ext->dense_removed)
+        return;
+
+    size_t cap = 4;
+    while (cap < ext->dense_num * 2)
+        cap *= 2;
+    size_t mask = cap - 1;
+    // индекс оставленного ключа + 1
+    size_t *index = calloc(cap, sizeof(index[0]));
+    assert(index);
+
+    size_t kept = ext->dense_num;
+    for (size_t i = ext->dense_num; i-- > 0;) {
+        const char *key = ext->dense[i];
+        if (!strset_exist(ext->set, key))
+            continue;
+
+        size_t j = strset_hash_str(ext->hasher, key) & mask;
+        bool seen = false;
+        for (; index[j]; j = (j + 1) & mask)
+            if (!strcmp(ext->dense[index[j] - 1], key)) {
+                seen = true;
+                break;
+            }
+        if (seen)
+            continue;
+
+        ext->dense[--kept] = key;
+        index[j] = kept + 1;
+    }
+    free(index);
+
+    size_t num = ext->dense_num - kept;
+    memmove(ext->dense, ext->dense + kept, sizeof(ext->dense[0]) * num);
+    ext->dense_num = num;
+    ext->dense_removed = 0;
+
+    // больше половины арены занято удаленными ключами - переложить
+    size_t live = 0;
+    for (size_t i = 0; i < num; i++)
+        live += strlen(ext->dense[i]) + 1;
+    if (live * 2 < ext->arena.used) {
+        StrArena old = ext->arena;
+        ext->arena = (StrArena) {};
+        for (size_t i = 0; i < num; i++) {
+            ext->dense[i] = strarena_strdup(
+                &ext->arena, ext->dense[i], strlen(ext->dense[i])
+            );
+        }
+        strarena_free(&old);
+    }
+}
+
+// }}}
+
+// {{{ Фильтр Блума
+
+static StrSetAction iter_bloom_add(const char *key, void *udata) {
+    StrSetExt *ext = udata;
+    strset_bloom_add(ext->bloom, strset_hash_str(ext->hasher, key));
+    return SSA_next;
+}
+
+static void bloom_rebuild(StrSetExt *ext, size_t keys_num) {
+    strset_bloom_free(ext->bloom);
+    ext->bloom = strset_bloom_new(
+        keys_num > BLOOM_KEYS_MIN ? keys_num : BLOOM_KEYS_MIN, 0
+    );
+    ext->bloom_removed = 0;
+    strset_each(ext->set, iter_bloom_add, ext);
+}
+
+// Ключ уже в наборе
+static void bloom_add(StrSetExt *ext, uint64_t hash) {
+    size_t count = strset_count(ext->set);
+    // удаленные ключи занимают место в фильтре наравне с живыми
+    if (count + ext->bloom_removed > strset_bloom_capacity(ext->bloom))
+        bloom_rebuild(ext, count * 2);
+    else
+        strset_bloom_add(ext->bloom, hash);
+}
+
+// }}}
+
+StrSetExt *strset_ext_new(struct StrSetExtSetup *setup) {
+    StrSetExt *ext = calloc(1, sizeof(*ext));
+    assert(ext);
+
+    ext->hasher = strset_hasher_default(setup ? setup->set.hasher : NULL);
+    ext->flags = setup ? setup->flags : 0;
+    ext->set = strset_new(&(struct StrSetSetup) {
+        .capacity = setup ? setup->set.capacity : 0,
+        .hasher = ext->hasher,
+    });
+    assert(ext->set);
+
+    if (ext->flags & SSX_bloom) {
+        size_t capacity = setup ? setup->set.capacity : 0;
+        ext->bloom = strset_bloom_new(
+            capacity > BLOOM_KEYS_MIN ? capacity : BLOOM_KEYS_MIN, 0
+        );
+    }
+    if (ext->flags & SSX_minhash)
+        ext->minhash = strminhash_new(setup->minhash_k, ext->hasher);
+    return ext;
+}
+
+void strset_ext_free(StrSetExt *ext) {
+    if (!ext)
+        return;
+    strset_free(ext->set);
+    strarena_free(&ext->arena);
+    free(ext->dense);
+    free(ext->snapshot);
+    strset_bloom_free(ext->bloom);
+    strminhash_free(ext->minhash);
+    free(ext);
+}
+
+void strset_ext_clear(StrSetExt *ext) {
+    assert(ext);
+    strset_clear(ext->set);
+    ext->fingerprint = 0;
+
+    strarena_free(&ext->arena);
+    ext->dense_num = ext->dense_removed = 0;
+
+    if (ext->bloom) {
+        strset_bloom_clear(ext->bloom);
+        ext->bloom_removed = 0;
+    }
+    if (ext->minhash) {
+        strminhash_clear(ext->minhash);
+        ext->minhash_stale = false;
+    }
+}
+
+bool strset_ext_add(StrSetExt *ext, const char *key) {
+    assert(ext);
+    assert(key);
+
+    size_t count = strset_count(ext->set);
+    strset_add(ext->set, key);
+    if (strset_count(ext->set) == count)
+        return false;
+
+    uint64_t hash = strset_hash_str(ext->hasher, key);
+    ext->fingerprint += hash;
+    if (ext->flags & SSX_dense)
+        dense_push(ext, key);
+    if (ext->bloom)
+        bloom_add(ext, hash);
+    if (ext->minhash && !ext->minhash_stale)
+        strminhash_add_hash(ext->minhash, hash);
+    return true;
+}
+
+bool strset_ext_exist(StrSetExt *ext, const char *key) {
+    assert(ext);
+    assert(key);
+    if (ext->bloom &&
+        !strset_bloom_maybe(ext->bloom, strset_hash_str(ext->hasher, key)))
+        return false;
+    return strset_exist(ext->set, key);
+}
+
+void strset_ext_remove(StrSetExt *ext, const char *key) {
+    assert(ext);
+    assert(key);
+
+    size_t count = strset_count(ext->set);
+    strset_remove(ext->set, key);
+    if (strset_count(ext->set) != count) {
+        ext->fingerprint -= strset_hash_str(ext->hasher, key);
+        ext->dense_removed++;
+        ext->bloom_removed++;
+        ext->minhash_stale = true;
+    }
+}
+
+size_t strset_ext_count(StrSetExt *ext) {
+    assert(ext);
+    return strset_count(ext->set);
+}
+
+struct EachCtx {
+    StrSetExt       *ext;
+    StrSetAction    (*cb)(const char *key, void *udata);
+    void            *udata;
+};
+
+static StrSetAction iter_each(const char *key, void *udata) {
+    struct EachCtx *ctx = udata;
+    StrSetAction action = ctx->cb(key, ctx->udata);
+    if (action == SSA_remove) {
+        ctx->ext->fingerprint -= strset_hash_str(ctx->ext->hasher, key);
+        ctx->ext->dense_removed++;
+        ctx->ext->bloom_removed++;
+        ctx->ext->minhash_stale = true;
+    }
+    return action;
+}
+
+void strset_ext_each(
+    StrSetExt *ext, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+) {
+    assert(ext);
+    assert(cb);
+
+    strset_each(ext->set, iter_each, &(struct EachCtx) {
+        .ext = ext,
+        .cb = cb,
+        .udata = udata,
+    });
+}
+
+StrSet *strset_ext_set(StrSetExt *ext) {
+    assert(ext);
+    return ext->set;
+}
+
+uint64_t strset_ext_fingerprint(StrSetExt *ext) {
+    assert(ext);
+    return ext->fingerprint;
+}
+
+uint64_t strset_fingerprint_strs(
+    HashFunction hasher, char **lines, size_t lines_num
+) {
+    hasher = strset_hasher_default(hasher);
+    uint64_t fingerprint = 0;
+    for (size_t i = 0; i < lines_num; i++)
+        fingerprint += strset_hash_str(hasher, lines[i]);
+    return fingerprint;
+}
+
+bool strset_ext_compare(StrSetExt *a, StrSetExt *b) {
+    assert(a);
+    assert(b);
+
+    if (strset_count(a->set) != strset_count(b->set))
+        return false;
+    // отпечатки сравнимы только при одной функции хэширования
+    if (a->hasher == b->hasher && a->fingerprint != b->fingerprint)
+        return false;
+    return strset_compare(a->set, b->set);
+}
+
+bool strset_ext_compare_strs(StrSetExt *ext, char **lines, size_t lines_num) {
+    assert(ext);
+    assert(lines || !lines_num);
+
+    size_t count = strset_count(ext->set);
+    // даже без повторов строк меньше, чем ключей
+    if (lines_num < count)
+        return false;
+    // Строк столько же, сколько ключей. Если это тот же набор, то повторов
+    // нет и отпечатки обязаны совпасть.
+    if (lines_num == count &&
+        strset_fingerprint_strs(ext->hasher, lines, lines_num) !=
+        ext->fingerprint)
+        return false;
+    return strset_compare_strs(ext->set, lines, lines_num);
+}
+
+static StrSetAction iter_minhash_add(const char *key, void *udata) {
+    StrSetExt *ext = udata;
+    strminhash_add_hash(ext->minhash, strset_hash_str(ext->hasher, key));
+    return SSA_next;
+}
+
+StrMinHash *strset_ext_minhash(StrSetExt *ext) {
+    assert(ext);
+    assert(ext->minhash);
+
+    if (ext->minhash_stale) {
+        strminhash_clear(ext->minhash);
+        strset_each(ext->set, iter_minhash_add, ext);
+        ext->minhash_stale = false;
+    }
+    return ext->minhash;
+}
+
+// {{{ Итератор
+
+static StrSetAction iter_snapshot(const char *key, void *udata) {
+    StrSetExt *ext = udata;
+    ext->snapshot[ext->snapshot_num++] = key;
+    return SSA_next;
+}
+
+StrSetExtIter strset_ext_iter_new(StrSetExt *ext) {
+    assert(ext);
+
+    if (ext->flags & SSX_dense) {
+        dense_compact(ext);
+    } else {
+        free(ext->snapshot);
+        ext->snapshot = malloc(
+            sizeof(ext->snapshot[0]) * (strset_count(ext->set) + 1)
+        );
+        assert(ext->snapshot);
+        ext->snapshot_num = 0;
+        strset_each(ext->set, iter_snapshot, ext);
+    }
+
+    return (StrSetExtIter) {
+        .ext = ext,
+        .i = 0,
+    };
+}
+
+bool strset_ext_iter_valid(StrSetExtIter *iter) {
+    assert(iter);
+    StrSetExt *ext = iter->ext;
+    return iter->i < (ext->flags & SSX_dense ?
+        ext->dense_num : ext->snapshot_num);
+}
+
+void strset_ext_iter_next(StrSetExtIter *iter) {
+    assert(iter);
+    iter->i++;
+}
+
+const char *strset_ext_iter_get(StrSetExtIter *iter) {
+    assert(strset_ext_iter_valid(iter));
+    StrSetExt *ext = iter->ext;
+    return ext->flags & SSX_dense ?
+        ext->dense[iter->i] : ext->snapshot[iter->i];
+}
+
+// }}}
@@ -0,0 +1,78 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include "koh_strset.h"
+#include "strminhash.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// StrSet с данными, которые поддерживаются при каждом изменении.
+// Отпечаток - сумма хэшей ключей, не зависит от порядка добавления.
+// Сравнение наборов сначала проверяет число ключей и отпечаток и только при
+// совпадении обоих обходит ключи.
+
+typedef enum StrSetExtFlags {
+    // Плотный массив ключей в порядке добавления для внешнего итератора.
+    // Ключи копируются в отдельную арену.
+    SSX_dense   = 1 << 0,
+    // Блочный фильтр Блума перед strset_ext_exist(): отсутствующие ключи
+    // отсекаются без обращения к таблице. Размер по capacity, при росте
+    // набора фильтр пересобирается.
+    SSX_bloom   = 1 << 1,
+    // Подпись MinHash обновляется при добавлении, после удаления
+    // пересчитывается при следующем запросе
+    SSX_minhash = 1 << 2,
+} StrSetExtFlags;
+
+struct StrSetExtSetup {
+    struct StrSetSetup  set;
+    // StrSetExtFlags
+    uint32_t            flags;
+    // размер подписи для SSX_minhash, 0 - по умолчанию
+    int                 minhash_k;
+};
+
+typedef struct StrSetExt StrSetExt;
+
+StrSetExt *strset_ext_new(struct StrSetExtSetup *setup);
+void strset_ext_free(StrSetExt *ext);
+void strset_ext_clear(StrSetExt *ext);
+// Возвращает true если ключ был добавлен
+bool strset_ext_add(StrSetExt *ext, const char *key);
+bool strset_ext_exist(StrSetExt *ext, const char *key);
+void strset_ext_remove(StrSetExt *ext, const char *key);
+size_t strset_ext_count(StrSetExt *ext);
+void strset_ext_each(
+    StrSetExt *ext, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+);
+// Только для чтения, изменения в обход strset_ext_* портят отпечаток и
+// фильтр Блума
+StrSet *strset_ext_set(StrSetExt *ext);
+
+uint64_t strset_ext_fingerprint(StrSetExt *ext);
+// Отпечаток набора строк без повторов
+uint64_t strset_fingerprint_strs(
+    HashFunction hasher, char **lines, size_t lines_num
+);
+
+bool strset_ext_compare(StrSetExt *a, StrSetExt *b);
+// Только с SSX_minhash. Подпись принадлежит ext.
+StrMinHash *strset_ext_minhash(StrSetExt *ext);
+bool strset_ext_compare_strs(StrSetExt *ext, char **lines, size_t lines_num);
+
+// Внешний итератор. С SSX_dense идет по плотному массиву в порядке
+// добавления, иначе по снимку ключей, снятому в strset_ext_iter_new().
+// Любое изменение набора делает итератор недействительным.
+typedef struct StrSetExtIter {
+    StrSetExt   *ext;
+    size_t      i;
+} StrSetExtIter;
+
+StrSetExtIter strset_ext_iter_new(StrSetExt *ext);
+bool strset_ext_iter_valid(StrSetExtIter *iter);
+void strset_ext_iter_next(StrSetExtIter *iter);
+const char *strset_ext_iter_get(StrSetExtIter *iter);
@@ -0,0 +1,156 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_fc.h"
+
+#include <assert.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define cpu_relax() _mm_pause()
+#else
+#define cpu_relax()
+#endif
+
+#define SLOTS_NUM_DEFAULT   128
+#define SPINS_BEFORE_YIELD  64
+
+enum Op {
+    OP_none,
+    OP_add,
+    OP_exist,
+    OP_remove,
+};
+
+struct Slot {
+    // OP_none - запрос выполнен, result можно читать
+    _Atomic int     op;
+    const char      *key;
+    bool            result;
+} __attribute__((aligned(64)));
+
+struct StrSetFC {
+    StrSet          *set;
+    struct Slot     *slots;
+    int             slots_num;
+    _Atomic int     slots_used;
+    _Atomic size_t  count;
+    atomic_flag     combiner __attribute__((aligned(64)));
+};
+
+StrSetFC *strset_fc_new(struct StrSetSetup *setup, int slots_num) {
+    StrSetFC *fc = aligned_alloc(64, sizeof(*fc));
+    assert(fc);
+    memset(fc, 0, sizeof(*fc));
+
+    fc->slots_num = slots_num ? slots_num : SLOTS_NUM_DEFAULT;
+    fc->slots = aligned_alloc(64, sizeof(fc->slots[0]) * fc->slots_num);
+    assert(fc->slots);
+    memset(fc->slots, 0, sizeof(fc->slots[0]) * fc->slots_num);
+
+    fc->set = strset_new(setup);
+    assert(fc->set);
+    atomic_flag_clear(&fc->combiner);
+    return fc;
+}
+
+void strset_fc_free(StrSetFC *fc) {
+    if (!fc)
+        return;
+    strset_free(fc->set);
+    free(fc->slots);
+    free(fc);
+}
+
+int strset_fc_register(StrSetFC *fc) {
+    assert(fc);
+    int slot = atomic_fetch_add(&fc->slots_used, 1);
+    assert(slot < fc->slots_num);
+    return slot;
+}
+
+static void combine(StrSetFC *fc) {
+    StrSet *set = fc->set;
+    int slots_used = atomic_load_explicit(&fc->slots_used, memory_order_acquire);
+
+    for (int i = 0; i < slots_used; i++) {
+        struct Slot *slot = &fc->slots[i];
+        int op = atomic_load_explicit(&slot->op, memory_order_acquire);
+        if (op == OP_none)
+            continue;
+
+        switch (op) {
+            case OP_add: {
+                size_t count = strset_count(set);
+                strset_add(set, slot->key);
+                slot->result = strset_count(set) != count;
+                break;
+            }
+            case OP_exist:
+                slot->result = strset_exist(set, slot->key);
+                break;
+            case OP_remove:
+                strset_remove(set, slot->key);
+                break;
+        }
+
+        atomic_store_explicit(&slot->op, OP_none, memory_order_release);
+    }
+
+    atomic_store_explicit(&fc->count, strset_count(set), memory_order_relaxed);
+}
+
+static bool request(StrSetFC *fc, int slot_index, enum Op op, const char *key) {
+    assert(fc);
+    assert(key);
+    assert(slot_index >= 0 && slot_index < fc->slots_num);
+
+    struct Slot *slot = &fc->slots[slot_index];
+    slot->key = key;
+    atomic_store_explicit(&slot->op, op, memory_order_release);
+
+    for (int spins = 0;; spins++) {
+        if (atomic_load_explicit(&slot->op, memory_order_acquire) == OP_none)
+            return slot->result;
+
+        if (!atomic_flag_test_and_set_explicit(
+            &fc->combiner, memory_order_acquire
+        )) {
+            combine(fc);
+            atomic_flag_clear_explicit(&fc->combiner, memory_order_release);
+            // свой запрос выполнен в combine()
+            continue;
+        }
+
+        if (spins < SPINS_BEFORE_YIELD)
+            cpu_relax();
+        else
+            sched_yield();
+    }
+}
+
+bool strset_fc_add(StrSetFC *fc, int slot, const char *key) {
+    return request(fc, slot, OP_add, key);
+}
+
+bool strset_fc_exist(StrSetFC *fc, int slot, const char *key) {
+    return request(fc, slot, OP_exist, key);
+}
+
+void strset_fc_remove(StrSetFC *fc, int slot, const char *key) {
+    request(fc, slot, OP_remove, key);
+}
+
+size_t strset_fc_count(StrSetFC *fc) {
+    assert(fc);
+    return atomic_load_explicit(&fc->count, memory_order_relaxed);
+}
+
+StrSet *strset_fc_set(StrSetFC *fc) {
+    assert(fc);
+    return fc->set;
+}
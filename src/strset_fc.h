@@ -0,0 +1,28 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Flat combining поверх одного StrSet. Поток кладет запрос в свой слот
+// публикации, поток захвативший роль комбайнера выполняет все ожидающие
+// запросы одной пачкой, пока таблица горячая в его кэше.
+
+typedef struct StrSetFC StrSetFC;
+
+// slots_num - наибольшее число потоков, 0 - значение по умолчанию
+StrSetFC *strset_fc_new(struct StrSetSetup *setup, int slots_num);
+void strset_fc_free(StrSetFC *fc);
+// Один раз на поток, возвращает номер слота публикации
+int strset_fc_register(StrSetFC *fc);
+
+// Возвращает true если ключ был добавлен
+bool strset_fc_add(StrSetFC *fc, int slot, const char *key);
+bool strset_fc_exist(StrSetFC *fc, int slot, const char *key);
+void strset_fc_remove(StrSetFC *fc, int slot, const char *key);
+size_t strset_fc_count(StrSetFC *fc);
+
+// Доступ к набору в обход комбайнера, когда других потоков нет
+StrSet *strset_fc_set(StrSetFC *fc);
@@ -0,0 +1,308 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_frozen.h"
+
+#include "strset_hash.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// AVX2 собирается через target("avx2") без -mavx2 и выбирается во время
+// выполнения по __builtin_cpu_supports()
+#if defined(__x86_64__) && defined(__GNUC__)
+#define FROZEN_AVX2 1
+#include <immintrin.h>
+#endif
+
+struct StrSetFrozen {
+    HashFunction    hasher;
+    size_t          num;
+    // отсортированы вместе, hashes отдельно для сканирования пачками
+    uint64_t        *hashes;
+    const char      **keys;
+    char            *buf;
+};
+
+struct Entry {
+    uint64_t    hash;
+    const char  *key;
+};
+
+struct CollectCtx {
+    HashFunction    hasher;
+    struct Entry    *entries;
+    size_t          num, buf_size;
+};
+
+static StrSetAction iter_collect(const char *key, void *udata) {
+    struct CollectCtx *ctx = udata;
+    ctx->entries[ctx->num++] = (struct Entry) {
+        .hash = strset_hash_str(ctx->hasher, key),
+        .key = key,
+    };
+    ctx->buf_size += strlen(key) + 1;
+    return SSA_next;
+}
+
+static inline int entry_cmp(
+    uint64_t a_hash, const char *a_key, uint64_t b_hash, const char *b_key
+) {
+    if (a_hash != b_hash)
+        return a_hash < b_hash ? -1 : 1;
+    return strcmp(a_key, b_key);
+}
+
+static int cmp_entry(const void *a, const void *b) {
+    const struct Entry *ea = a, *eb = b;
+    return entry_cmp(ea->hash, ea->key, eb->hash, eb->key);
+}
+
+StrSetFrozen *strset_frozen_new(StrSet *set, HashFunction hasher) {
+    assert(set);
+
+    StrSetFrozen *frozen = calloc(1, sizeof(*frozen));
+    assert(frozen);
+    frozen->hasher = strset_hasher_default(hasher);
+
+    size_t count = strset_count(set);
+    struct CollectCtx ctx = {
+        .hasher = frozen->hasher,
+        .entries = malloc(sizeof(struct Entry) * (count + 1)),
+    };
+    assert(ctx.entries);
+    strset_each(set, iter_collect, &ctx);
+    assert(ctx.num == count);
+
+    qsort(ctx.entries, ctx.num, sizeof(ctx.entries[0]), cmp_entry);
+
+    frozen->num = ctx.num;
+    frozen->hashes = malloc(sizeof(frozen->hashes[0]) * (ctx.num + 1));
+    frozen->keys = malloc(sizeof(frozen->keys[0]) * (ctx.num + 1));
+    frozen->buf = malloc(ctx.buf_size + 1);
+    assert(frozen->hashes && frozen->keys && frozen->buf);
+
+    // ключи в буфере в порядке сортировки, слияние читает память подряд
+    char *p = frozen->buf;
+    for (size_t i = 0; i < ctx.num; i++) {
+        size_t len = strlen(ctx.entries[i].key) + 1;
+        memcpy(p, ctx.entries[i].key, len);
+        frozen->hashes[i] = ctx.entries[i].hash;
+        frozen->keys[i] = p;
+        p += len;
+    }
+
+    free(ctx.entries);
+    return frozen;
+}
+
+void strset_frozen_free(StrSetFrozen *frozen) {
+    if (!frozen)
+        return;
+    free(frozen->hashes);
+    free(frozen->keys);
+    free(frozen->buf);
+    free(frozen);
+}
+
+size_t strset_frozen_count(StrSetFrozen *frozen) {
+    assert(frozen);
+    return frozen->num;
+}
+
+// Первый индекс i >= from с hashes[i] >= h
+static size_t lower_bound(
+    const uint64_t *hashes, size_t from, size_t num, uint64_t h
+) {
+    size_t lo = from, hi = num;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (hashes[mid] < h)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+typedef size_t (*SkipLess)(
+    const uint64_t *hashes, size_t j, size_t num, uint64_t h
+);
+
+// То же, но для коротких прыжков при слиянии: сначала линейно, затем
+// двоичный поиск если цель далеко
+static size_t skip_less_scalar(
+    const uint64_t *hashes, size_t j, size_t num, uint64_t h
+) {
+    for (int i = 0; i < 16 && j < num; i++, j++)
+        if (hashes[j] >= h)
+            return j;
+    return lower_bound(hashes, j, num, h);
+}
+
+#if defined(FROZEN_AVX2)
+// Линейная часть пачками по 4 хэша
+__attribute__((target("avx2")))
+static size_t skip_less_avx2(
+    const uint64_t *hashes, size_t j, size_t num, uint64_t h
+) {
+    // беззнаковое сравнение через сдвиг знакового бита
+    const __m256i bias = _mm256_set1_epi64x((int64_t)0x8000000000000000ull);
+    const __m256i target = _mm256_xor_si256(
+        _mm256_set1_epi64x((int64_t)h), bias
+    );
+
+    for (int blocks = 0; j + 4 <= num && blocks < 4; blocks++) {
+        __m256i v = _mm256_xor_si256(
+            _mm256_loadu_si256((const __m256i*)&hashes[j]), bias
+        );
+        // маска элементов меньше цели, массив отсортирован
+        int less = _mm256_movemask_pd(
+            _mm256_castsi256_pd(_mm256_cmpgt_epi64(target, v))
+        );
+        if (less != 0xf)
+            return j + __builtin_popcount(less);
+        j += 4;
+    }
+    return lower_bound(hashes, j, num, h);
+}
+#endif
+
+static bool avx2_enabled = true;
+
+static bool avx2_supported(void) {
+#if defined(FROZEN_AVX2)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+bool strset_frozen_use_avx2(bool enable) {
+    avx2_enabled = enable;
+    return enable && avx2_supported();
+}
+
+static SkipLess skip_less_get(void) {
+#if defined(FROZEN_AVX2)
+    if (avx2_enabled && avx2_supported())
+        return skip_less_avx2;
+#endif
+    return skip_less_scalar;
+}
+
+bool strset_frozen_exist(StrSetFrozen *frozen, const char *key) {
+    assert(frozen);
+    assert(key);
+
+    uint64_t h = strset_hash_str(frozen->hasher, key);
+    for (size_t i = lower_bound(frozen->hashes, 0, frozen->num, h);
+         i < frozen->num && frozen->hashes[i] == h; i++)
+        if (!strcmp(frozen->keys[i], key))
+            return true;
+    return false;
+}
+
+void strset_frozen_each(
+    StrSetFrozen *frozen, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+) {
+    assert(frozen);
+    assert(cb);
+
+    for (size_t i = 0; i < frozen->num; i++) {
+        StrSetAction action = cb(frozen->keys[i], udata);
+        assert(action != SSA_remove);
+        if (action != SSA_next)
+            break;
+    }
+}
+
+// Слияние: для каждого ключа a вызывается emit с признаком наличия в b
+static void merge(
+    StrSetFrozen *a, StrSetFrozen *b,
+    void (*emit)(const char *key, bool in_b, void *udata), void *udata
+) {
+    assert(a);
+    assert(b);
+    assert(a->hasher == b->hasher);
+
+    SkipLess skip_less = skip_less_get();
+    size_t j = 0;
+    for (size_t i = 0; i < a->num; i++) {
+        uint64_t h = a->hashes[i];
+        if (j < b->num && b->hashes[j] < h)
+            j = skip_less(b->hashes, j, b->num, h);
+
+        int cmp = 1;
+        while (j < b->num &&
+            (cmp = entry_cmp(b->hashes[j], b->keys[j], h, a->keys[i])) < 0)
+            j++;
+
+        emit(a->keys[i], j < b->num && cmp == 0, udata);
+    }
+}
+
+struct EmitCtx {
+    StrSet  *dst;
+    size_t  num;
+    bool    keep_in_b;
+};
+
+static void emit_add(const char *key, bool in_b, void *udata) {
+    struct EmitCtx *ctx = udata;
+    if (in_b == ctx->keep_in_b)
+        strset_add(ctx->dst, key);
+}
+
+static void emit_count(const char *key, bool in_b, void *udata) {
+    struct EmitCtx *ctx = udata;
+    if (in_b == ctx->keep_in_b)
+        ctx->num++;
+}
+
+static StrSet *frozen_op(StrSetFrozen *a, StrSetFrozen *b, bool keep_in_b) {
+    struct EmitCtx ctx = {
+        .dst = strset_new(&(struct StrSetSetup) {
+            .capacity = a->num,
+            .hasher = a->hasher,
+        }),
+        .keep_in_b = keep_in_b,
+    };
+    assert(ctx.dst);
+    merge(a, b, emit_add, &ctx);
+    return ctx.dst;
+}
+
+StrSet *strset_frozen_difference(StrSetFrozen *a, StrSetFrozen *b) {
+    return frozen_op(a, b, false);
+}
+
+StrSet *strset_frozen_intersection(StrSetFrozen *a, StrSetFrozen *b) {
+    return frozen_op(a, b, true);
+}
+
+size_t strset_frozen_difference_count(StrSetFrozen *a, StrSetFrozen *b) {
+    struct EmitCtx ctx = {
+        .keep_in_b = false,
+    };
+    merge(a, b, emit_count, &ctx);
+    return ctx.num;
+}
+
+bool strset_frozen_compare(StrSetFrozen *a, StrSetFrozen *b) {
+    assert(a);
+    assert(b);
+    assert(a->hasher == b->hasher);
+
+    if (a->num != b->num)
+        return false;
+    // равные наборы дают одинаковые отсортированные массивы хэшей
+    if (memcmp(a->hashes, b->hashes, sizeof(a->hashes[0]) * a->num))
+        return false;
+    for (size_t i = 0; i < a->num; i++)
+        if (strcmp(a->keys[i], b->keys[i]))
+            return false;
+    return true;
+}
@@ -0,0 +1,37 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Неизменяемый снимок набора: ключи упакованы в один буфер и отсортированы
+// по (хэш, strcmp). Разность, пересечение и сравнение двух снимков
+// выполняются линейным слиянием, пропуск по массиву хэшей идет пачками
+// AVX2 сравнений, если процессор их поддерживает.
+
+typedef struct StrSetFrozen StrSetFrozen;
+
+// hasher == NULL - по умолчанию. Сливать можно только снимки с одним hasher.
+StrSetFrozen *strset_frozen_new(StrSet *set, HashFunction hasher);
+void strset_frozen_free(StrSetFrozen *frozen);
+size_t strset_frozen_count(StrSetFrozen *frozen);
+// Двоичный поиск по массиву хэшей
+bool strset_frozen_exist(StrSetFrozen *frozen, const char *key);
+// Ключи в порядке хэшей, SSA_remove не поддерживается
+void strset_frozen_each(
+    StrSetFrozen *frozen, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+);
+
+StrSet *strset_frozen_difference(StrSetFrozen *a, StrSetFrozen *b);
+StrSet *strset_frozen_intersection(StrSetFrozen *a, StrSetFrozen *b);
+size_t strset_frozen_difference_count(StrSetFrozen *a, StrSetFrozen *b);
+bool strset_frozen_compare(StrSetFrozen *a, StrSetFrozen *b);
+
+// Разрешить или запретить путь AVX2 при слиянии, по умолчанию разрешен.
+// Возвращает true, если AVX2 будет использоваться. Глобально, не менять во
+// время слияний. Для тестов и замеров.
+bool strset_frozen_use_avx2(bool enable);
@@ -0,0 +1,38 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include "koh_strset.h"
+#include <stdint.h>
+#include <string.h>
+
+// Финализатор splitmix64. Нужен что-бы старшие биты были пригодны для
+// разбиения на шарды даже у 32-битных функций из koh_hashers.
+static inline uint64_t strset_hash_mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+static inline HashFunction strset_hasher_default(HashFunction hasher) {
+    return hasher ? hasher : koh_hashers[0].f;
+}
+
+static inline uint64_t strset_hash(
+    HashFunction hasher, const char *key, size_t len
+) {
+    return strset_hash_mix((uint64_t)hasher(key, len));
+}
+
+static inline uint64_t strset_hash_str(HashFunction hasher, const char *key) {
+    return strset_hash(hasher, key, strlen(key));
+}
+
+// Номер части из 2^bits по старшим битам смешанного хэша
+static inline int strset_hash_part(uint64_t h, int bits) {
+    return bits ? (int)(h >> (64 - bits)) : 0;
+}
@@ -0,0 +1,277 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_io.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WRITE_BUF_SIZE  (1024 * 1024)
+#define READ_BUF_SIZE   (1024 * 1024)
+
+// {{{ Вывод
+
+struct WriteCtx {
+    int         fd;
+    char        *buf;
+    size_t      used;
+    bool        failed;
+
+    const char  *fmt;
+    // fmt вида "<prefix>%s<suffix>"
+    bool        simple;
+    const char  *prefix, *suffix;
+    size_t      prefix_len, suffix_len;
+};
+
+static bool write_all(int fd, const char *data, size_t len) {
+    while (len) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        len -= written;
+    }
+    return true;
+}
+
+static void ctx_flush(struct WriteCtx *ctx) {
+    if (!ctx->failed && !write_all(ctx->fd, ctx->buf, ctx->used))
+        ctx->failed = true;
+    ctx->used = 0;
+}
+
+static void ctx_put(struct WriteCtx *ctx, const char *data, size_t len) {
+    if (ctx->used + len > WRITE_BUF_SIZE)
+        ctx_flush(ctx);
+    if (len > WRITE_BUF_SIZE) {
+        if (!ctx->failed && !write_all(ctx->fd, data, len))
+            ctx->failed = true;
+        return;
+    }
+    memcpy(ctx->buf + ctx->used, data, len);
+    ctx->used += len;
+}
+
+static void fmt_parse(struct WriteCtx *ctx, const char *fmt) {
+    ctx->fmt = fmt;
+    const char *spec = strstr(fmt, "%s");
+    if (!spec || strchr(spec + 2, '%') ||
+        memchr(fmt, '%', spec - fmt))
+        return;
+
+    ctx->simple = true;
+    ctx->prefix = fmt;
+    ctx->prefix_len = spec - fmt;
+    ctx->suffix = spec + 2;
+    ctx->suffix_len = strlen(ctx->suffix);
+}
+
+static StrSetAction iter_write_simple(const char *key, void *udata) {
+    struct WriteCtx *ctx = udata;
+    size_t key_len = strlen(key),
+           len = ctx->prefix_len + key_len + ctx->suffix_len;
+
+    if (ctx->used + len > WRITE_BUF_SIZE || len > WRITE_BUF_SIZE) {
+        ctx_put(ctx, ctx->prefix, ctx->prefix_len);
+        ctx_put(ctx, key, key_len);
+        ctx_put(ctx, ctx->suffix, ctx->suffix_len);
+        return SSA_next;
+    }
+
+    char *p = ctx->buf + ctx->used;
+    memcpy(p, ctx->prefix, ctx->prefix_len);
+    p += ctx->prefix_len;
+    memcpy(p, key, key_len);
+    p += key_len;
+    memcpy(p, ctx->suffix, ctx->suffix_len);
+    ctx->used += len;
+    return SSA_next;
+}
+
+static StrSetAction iter_write_fmt(const char *key, void *udata) {
+    struct WriteCtx *ctx = udata;
+    size_t space = WRITE_BUF_SIZE - ctx->used;
+    int len = snprintf(ctx->buf + ctx->used, space, ctx->fmt, key);
+    assert(len >= 0);
+
+    if ((size_t)len < space) {
+        ctx->used += len;
+        return SSA_next;
+    }
+
+    ctx_flush(ctx);
+    if ((size_t)len < WRITE_BUF_SIZE) {
+        snprintf(ctx->buf, WRITE_BUF_SIZE, ctx->fmt, key);
+        ctx->used = len;
+        return SSA_next;
+    }
+
+    // длиннее буфера
+    char *tmp = malloc(len + 1);
+    assert(tmp);
+    snprintf(tmp, len + 1, ctx->fmt, key);
+    ctx_put(ctx, tmp, len);
+    free(tmp);
+    return SSA_next;
+}
+
+bool strset_write_fd(StrSet *set, int fd, const char *fmt) {
+    assert(set);
+    assert(fd >= 0);
+
+    struct WriteCtx ctx = {
+        .fd = fd,
+        .buf = malloc(WRITE_BUF_SIZE),
+    };
+    assert(ctx.buf);
+    fmt_parse(&ctx, fmt ? fmt : "%s\n");
+
+    strset_each(set, ctx.simple ? iter_write_simple : iter_write_fmt, &ctx);
+    ctx_flush(&ctx);
+
+    free(ctx.buf);
+    return !ctx.failed;
+}
+
+bool strset_write_f(StrSet *set, FILE *f, const char *fmt) {
+    assert(f);
+    if (fflush(f))
+        return false;
+    return strset_write_fd(set, fileno(f), fmt);
+}
+
+// }}}
+
+// {{{ Чтение строк
+
+bool strset_line_trim(char **line, size_t *len, uint32_t flags) {
+    assert(line && *line);
+    assert(len);
+
+    char *s = *line;
+    size_t n = *len;
+
+    if (flags & SSR_trim_cr && n && s[n - 1] == '\r')
+        s[--n] = 0;
+
+    if (flags & SSR_trim_space) {
+        while (n && isspace((unsigned char)s[n - 1]))
+            s[--n] = 0;
+        while (n && isspace((unsigned char)*s)) {
+            s++;
+            n--;
+        }
+    }
+
+    *line = s;
+    *len = n;
+    return n || !(flags & SSR_skip_empty);
+}
+
+static bool line_emit(
+    char *line, size_t len, uint32_t flags,
+    bool (*cb)(char *line, size_t len, void *udata), void *udata
+) {
+    if (!strset_line_trim(&line, &len, flags))
+        return true;
+    return cb(line, len, udata);
+}
+
+bool strset_fd_each_line(
+    int fd, uint32_t flags,
+    bool (*cb)(char *line, size_t len, void *udata), void *udata
+) {
+    assert(fd >= 0);
+    assert(cb);
+
+    size_t cap = READ_BUF_SIZE;
+    // место под завершающий ноль последней строки
+    char *buf = malloc(cap + 1);
+    assert(buf);
+
+    // len - байт в буфере, в первых len байтах нет '\n'
+    size_t len = 0;
+    bool ok = true, stop = false;
+
+    while (!stop) {
+        // строка не поместилась в буфер
+        if (len == cap) {
+            cap *= 2;
+            buf = realloc(buf, cap + 1);
+            assert(buf);
+        }
+
+        ssize_t got = read(fd, buf + len, cap - len);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            ok = false;
+            break;
+        }
+        if (!got)
+            break;
+
+        char *line = buf, *end = buf + len + got, *nl;
+        for (char *p = buf + len; (nl = memchr(p, '\n', end - p)); p = line) {
+            *nl = 0;
+            if (!line_emit(line, nl - line, flags, cb, udata)) {
+                stop = true;
+                break;
+            }
+            line = nl + 1;
+        }
+
+        len = end - line;
+        memmove(buf, line, len);
+    }
+
+    if (ok && !stop && len) {
+        buf[len] = 0;
+        line_emit(buf, len, flags, cb, udata);
+    }
+
+    free(buf);
+    return ok;
+}
+
+bool strset_file_each_line(
+    const char *path, uint32_t flags,
+    bool (*cb)(char *line, size_t len, void *udata), void *udata
+) {
+    assert(path);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    bool ok = strset_fd_each_line(fd, flags, cb, udata);
+    close(fd);
+    return ok;
+}
+
+static bool line_add(char *line, size_t len, void *udata) {
+    strset_add(udata, line);
+    return true;
+}
+
+bool strset_add_fd(StrSet *set, int fd, uint32_t flags) {
+    assert(set);
+    return strset_fd_each_line(fd, flags, line_add, set);
+}
+
+bool strset_add_file(StrSet *set, const char *path, uint32_t flags) {
+    assert(set);
+    return strset_file_each_line(path, flags, line_add, set);
+}
+
+// }}}
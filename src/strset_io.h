@@ -0,0 +1,59 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// {{{ Вывод
+
+// Вывод ключей набора большими блоками вместо fprintf() на каждый ключ.
+// fmt как у strset_print_f() с одним аргументом - ключом. Формат вида
+// "<префикс>%s<суффикс>" без других '%' копируется через memcpy() без
+// разбора, остальные форматы идут через snprintf() в тот же буфер.
+// NULL равнозначен "%s\n". Возвращает false при ошибке записи.
+
+bool strset_write_fd(StrSet *set, int fd, const char *fmt);
+// Сбрасывает буфер f и пишет напрямую в fileno(f)
+bool strset_write_f(StrSet *set, FILE *f, const char *fmt);
+
+// }}}
+
+// {{{ Чтение строк
+
+typedef enum StrSetReadFlags {
+    // убрать '\r' в конце строки
+    SSR_trim_cr     = 1 << 0,
+    // убрать пробельные символы в начале и в конце строки
+    SSR_trim_space  = 1 << 1,
+    // не передавать пустые строки (после обрезки)
+    SSR_skip_empty  = 1 << 2,
+} StrSetReadFlags;
+
+// Файл читается блоками по 1Мб, переводы строк ищутся memchr() и заменяются
+// нулем прямо в блоке. Строка передается без копирования, длина строки не
+// ограничена. Последняя строка без '\n' тоже передается. Строка с нулевым
+// байтом внутри обрезается на нем.
+// line изменяема и действительна только внутри вызова, cb возвращает false
+// для остановки. Возвращает false при ошибке открытия или чтения.
+bool strset_fd_each_line(
+    int fd, uint32_t flags,
+    bool (*cb)(char *line, size_t len, void *udata), void *udata
+);
+bool strset_file_each_line(
+    const char *path, uint32_t flags,
+    bool (*cb)(char *line, size_t len, void *udata), void *udata
+);
+
+// Обрезка строки по flags на месте. Возвращает false, если строку нужно
+// пропустить (SSR_skip_empty).
+bool strset_line_trim(char **line, size_t *len, uint32_t flags);
+
+// Добавить каждую строку файла как ключ. flags - StrSetReadFlags.
+bool strset_add_fd(StrSet *set, int fd, uint32_t flags);
+bool strset_add_file(StrSet *set, const char *path, uint32_t flags);
+
+// }}}
@@ -0,0 +1,392 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_ops.h"
+
+#include "strset_hash.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct OpCtx {
+    StrSet  *dst, *other;
+};
+
+// hasher из setup, емкость не меньше нужной результату
+static StrSet *set_new_sized(struct StrSetSetup *setup, size_t capacity) {
+    StrSet *set = strset_new(&(struct StrSetSetup) {
+        .capacity = setup && setup->capacity > capacity ?
+            setup->capacity : capacity,
+        .hasher = strset_hasher_default(setup ? setup->hasher : NULL),
+    });
+    assert(set);
+    return set;
+}
+
+static StrSetAction iter_add(const char *key, void *udata) {
+    struct OpCtx *ctx = udata;
+    strset_add(ctx->dst, key);
+    return SSA_next;
+}
+
+static StrSetAction iter_add_missing(const char *key, void *udata) {
+    struct OpCtx *ctx = udata;
+    if (!strset_exist(ctx->other, key))
+        strset_add(ctx->dst, key);
+    return SSA_next;
+}
+
+static StrSetAction iter_add_common(const char *key, void *udata) {
+    struct OpCtx *ctx = udata;
+    if (strset_exist(ctx->other, key))
+        strset_add(ctx->dst, key);
+    return SSA_next;
+}
+
+static StrSetAction iter_remove_missing(const char *key, void *udata) {
+    struct OpCtx *ctx = udata;
+    return strset_exist(ctx->other, key) ? SSA_next : SSA_remove;
+}
+
+static StrSetAction iter_remove_common(const char *key, void *udata) {
+    struct OpCtx *ctx = udata;
+    return strset_exist(ctx->other, key) ? SSA_remove : SSA_next;
+}
+
+StrSet *strset_union(StrSet *a, StrSet *b, struct StrSetSetup *setup) {
+    assert(a);
+    assert(b);
+
+    size_t a_num = strset_count(a), b_num = strset_count(b);
+    StrSet *big = a_num >= b_num ? a : b, *small = big == a ? b : a;
+    StrSet *dst = set_new_sized(setup, a_num + b_num);
+
+    strset_each(big, iter_add, &(struct OpCtx) { .dst = dst });
+    strset_each(small, iter_add_missing, &(struct OpCtx) {
+        .dst = dst,
+        .other = big,
+    });
+    return dst;
+}
+
+StrSet *strset_intersection(
+    StrSet *a, StrSet *b, struct StrSetSetup *setup
+) {
+    assert(a);
+    assert(b);
+
+    size_t a_num = strset_count(a), b_num = strset_count(b);
+    StrSet *small = a_num <= b_num ? a : b, *big = small == a ? b : a;
+    StrSet *dst = set_new_sized(setup, strset_count(small));
+
+    strset_each(small, iter_add_common, &(struct OpCtx) {
+        .dst = dst,
+        .other = big,
+    });
+    return dst;
+}
+
+StrSet *strset_symmetric_difference(
+    StrSet *a, StrSet *b, struct StrSetSetup *setup
+) {
+    assert(a);
+    assert(b);
+
+    StrSet *dst = set_new_sized(setup, strset_count(a) + strset_count(b));
+    strset_each(a, iter_add_missing, &(struct OpCtx) {
+        .dst = dst,
+        .other = b,
+    });
+    strset_each(b, iter_add_missing, &(struct OpCtx) {
+        .dst = dst,
+        .other = a,
+    });
+    return dst;
+}
+
+void strset_difference_into(StrSet *dst, StrSet *a, StrSet *b) {
+    assert(dst);
+    assert(a);
+    assert(b);
+
+    // a \ a пусто при любом dst
+    if (a == b) {
+        strset_clear(dst);
+        return;
+    }
+
+    // dst = a \ dst: результат собирается отдельно, dst нельзя менять,
+    // пока по нему проверяются ключи a
+    if (dst == b) {
+        StrSet *tmp = set_new_sized(NULL, strset_count(a));
+        strset_each(a, iter_add_missing, &(struct OpCtx) {
+            .dst = tmp,
+            .other = b,
+        });
+        strset_clear(dst);
+        strset_each(tmp, iter_add, &(struct OpCtx) { .dst = dst });
+        strset_free(tmp);
+        return;
+    }
+
+    if (dst == a) {
+        strset_each(dst, iter_remove_common, &(struct OpCtx) { .other = b });
+        return;
+    }
+
+    strset_clear(dst);
+    strset_each(a, iter_add_missing, &(struct OpCtx) {
+        .dst = dst,
+        .other = b,
+    });
+}
+
+void strset_intersect_inplace(StrSet *dst, StrSet *other) {
+    assert(dst);
+    assert(other);
+
+    if (dst == other)
+        return;
+    strset_each(dst, iter_remove_missing, &(struct OpCtx) { .other = other });
+}
+
+void strset_union_inplace(StrSet *dst, StrSet *other) {
+    assert(dst);
+    assert(other);
+
+    if (dst == other)
+        return;
+    strset_each(other, iter_add, &(struct OpCtx) { .dst = dst });
+}
+
+// {{{ Операции над массивом наборов
+
+StrSet *strset_union_many(
+    StrSet **sets, int sets_num, struct StrSetSetup *setup
+) {
+    assert(sets || !sets_num);
+
+    size_t capacity = 0;
+    for (int i = 0; i < sets_num; i++) {
+        assert(sets[i]);
+        capacity += strset_count(sets[i]);
+    }
+
+    StrSet *dst = set_new_sized(setup, capacity);
+    for (int i = 0; i < sets_num; i++)
+        strset_each(sets[i], iter_add, &(struct OpCtx) { .dst = dst });
+    return dst;
+}
+
+static int cmp_count(const void *a, const void *b) {
+    size_t a_num = strset_count(*(StrSet**)a),
+           b_num = strset_count(*(StrSet**)b);
+    return (a_num > b_num) - (a_num < b_num);
+}
+
+struct ManyCtx {
+    StrSet  *dst, **others;
+    int     others_num;
+};
+
+static StrSetAction iter_add_common_many(const char *key, void *udata) {
+    struct ManyCtx *ctx = udata;
+    for (int i = 0; i < ctx->others_num; i++)
+        if (!strset_exist(ctx->others[i], key))
+            return SSA_next;
+    strset_add(ctx->dst, key);
+    return SSA_next;
+}
+
+StrSet *strset_intersection_many(
+    StrSet **sets, int sets_num, struct StrSetSetup *setup
+) {
+    assert(sets || !sets_num);
+
+    if (!sets_num)
+        return set_new_sized(setup, 0);
+
+    StrSet **sorted = malloc(sizeof(sorted[0]) * sets_num);
+    assert(sorted);
+    memcpy(sorted, sets, sizeof(sorted[0]) * sets_num);
+    qsort(sorted, sets_num, sizeof(sorted[0]), cmp_count);
+
+    StrSet *dst = set_new_sized(setup, strset_count(sorted[0]));
+    if (strset_count(sorted[0]))
+        strset_each(sorted[0], iter_add_common_many, &(struct ManyCtx) {
+            .dst = dst,
+            .others = sorted + 1,
+            .others_num = sets_num - 1,
+        });
+
+    free(sorted);
+    return dst;
+}
+
+// }}}
+
+// {{{ Представления
+
+StrSetView strset_view_difference(StrSet *a, StrSet *b) {
+    return (StrSetView) { .a = a, .b = b, .op = SSV_difference, };
+}
+
+StrSetView strset_view_intersection(StrSet *a, StrSet *b) {
+    return (StrSetView) { .a = a, .b = b, .op = SSV_intersection, };
+}
+
+StrSetView strset_view_union(StrSet *a, StrSet *b) {
+    return (StrSetView) { .a = a, .b = b, .op = SSV_union, };
+}
+
+StrSetView strset_view_symmetric_difference(StrSet *a, StrSet *b) {
+    return (StrSetView) { .a = a, .b = b, .op = SSV_symmetric_difference, };
+}
+
+struct CountCtx {
+    StrSet  *other;
+    size_t  num;
+};
+
+static StrSetAction iter_count_missing(const char *key, void *udata) {
+    struct CountCtx *ctx = udata;
+    if (!strset_exist(ctx->other, key))
+        ctx->num++;
+    return SSA_next;
+}
+
+static StrSetAction iter_count_common(const char *key, void *udata) {
+    struct CountCtx *ctx = udata;
+    if (strset_exist(ctx->other, key))
+        ctx->num++;
+    return SSA_next;
+}
+
+size_t strset_difference_count(StrSet *a, StrSet *b) {
+    assert(a);
+    assert(b);
+
+    struct CountCtx ctx = { .other = b, };
+    strset_each(a, iter_count_missing, &ctx);
+    return ctx.num;
+}
+
+size_t strset_intersection_count(StrSet *a, StrSet *b) {
+    assert(a);
+    assert(b);
+
+    StrSet *small = strset_count(a) <= strset_count(b) ? a : b,
+           *big = small == a ? b : a;
+    struct CountCtx ctx = { .other = big, };
+    strset_each(small, iter_count_common, &ctx);
+    return ctx.num;
+}
+
+bool strset_view_exist(StrSetView *view, const char *key) {
+    assert(view);
+    assert(key);
+
+    switch (view->op) {
+        case SSV_difference:
+            return strset_exist(view->a, key) && !strset_exist(view->b, key);
+        case SSV_intersection:
+            return strset_exist(view->a, key) && strset_exist(view->b, key);
+        case SSV_union:
+            return strset_exist(view->a, key) || strset_exist(view->b, key);
+        case SSV_symmetric_difference:
+            return strset_exist(view->a, key) != strset_exist(view->b, key);
+    }
+    return false;
+}
+
+size_t strset_view_count(StrSetView *view) {
+    assert(view);
+
+    size_t a_num = strset_count(view->a), b_num = strset_count(view->b);
+    switch (view->op) {
+        case SSV_difference:
+            return strset_difference_count(view->a, view->b);
+        case SSV_intersection:
+            return strset_intersection_count(view->a, view->b);
+        case SSV_union:
+            return a_num + b_num - strset_intersection_count(view->a, view->b);
+        case SSV_symmetric_difference:
+            return a_num + b_num -
+                2 * strset_intersection_count(view->a, view->b);
+    }
+    return 0;
+}
+
+struct ViewCtx {
+    StrSetAction    (*cb)(const char *key, void *udata);
+    void            *udata;
+    // ключ берется если его наличие в other равно in_other,
+    // other == NULL - берутся все ключи
+    StrSet          *other;
+    bool            in_other, stopped;
+};
+
+static StrSetAction iter_view(const char *key, void *udata) {
+    struct ViewCtx *ctx = udata;
+    if (ctx->stopped)
+        return SSA_next;
+    if (ctx->other && strset_exist(ctx->other, key) != ctx->in_other)
+        return SSA_next;
+
+    // Входные наборы представлению не принадлежат, SSA_remove не должен
+    // дойти до strset_each() и в сборке с NDEBUG
+    StrSetAction action = ctx->cb(key, ctx->udata);
+    if (action == SSA_remove)
+        return SSA_next;
+    if (action != SSA_next)
+        ctx->stopped = true;
+    return action;
+}
+
+// Обойти ключи from, наличие которых в other равно in_other.
+// Возвращает false если обход остановлен обратным вызовом.
+static bool view_each_part(
+    struct ViewCtx *ctx, StrSet *from, StrSet *other, bool in_other
+) {
+    ctx->other = other;
+    ctx->in_other = in_other;
+    if (!ctx->stopped)
+        strset_each(from, iter_view, ctx);
+    return !ctx->stopped;
+}
+
+void strset_view_each(
+    StrSetView *view, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+) {
+    assert(view);
+    assert(cb);
+
+    struct ViewCtx ctx = {
+        .cb = cb,
+        .udata = udata,
+    };
+    StrSet *a = view->a, *b = view->b;
+
+    switch (view->op) {
+        case SSV_difference:
+            view_each_part(&ctx, a, b, false);
+            break;
+        case SSV_intersection: {
+            StrSet *small = strset_count(a) <= strset_count(b) ? a : b,
+                   *big = small == a ? b : a;
+            view_each_part(&ctx, small, big, true);
+            break;
+        }
+        case SSV_union:
+            if (view_each_part(&ctx, a, NULL, false))
+                view_each_part(&ctx, b, a, false);
+            break;
+        case SSV_symmetric_difference:
+            if (view_each_part(&ctx, a, b, false))
+                view_each_part(&ctx, b, a, false);
+            break;
+    }
+}
+
+// }}}
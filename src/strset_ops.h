@@ -0,0 +1,73 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Операции над множествами в дополнение к strset_difference().
+// Результат создается сразу с нужной емкостью, по возможности обходится
+// меньший из наборов. Hasher результата берется из setup, как в
+// strset_new(), у входных наборов он не наследуется. setup == NULL -
+// hasher по умолчанию, емкость из setup используется, если она больше
+// нужной результату.
+
+StrSet *strset_union(StrSet *a, StrSet *b, struct StrSetSetup *setup);
+StrSet *strset_intersection(
+    StrSet *a, StrSet *b, struct StrSetSetup *setup
+);
+StrSet *strset_symmetric_difference(
+    StrSet *a, StrSet *b, struct StrSetSetup *setup
+);
+
+// dst = a \ b, содержимое dst заменяется. dst может совпадать с a или b,
+// при a == b dst просто очищается.
+void strset_difference_into(StrSet *dst, StrSet *a, StrSet *b);
+// dst = dst ∩ other
+void strset_intersect_inplace(StrSet *dst, StrSet *other);
+// dst = dst ∪ other
+void strset_union_inplace(StrSet *dst, StrSet *other);
+
+// Операции над массивом наборов за один проход, без промежуточных наборов.
+// Пересечение обходит наименьший набор и проверяет остальные по
+// возрастанию размера, выходя на первом промахе.
+StrSet *strset_union_many(
+    StrSet **sets, int sets_num, struct StrSetSetup *setup
+);
+StrSet *strset_intersection_many(
+    StrSet **sets, int sets_num, struct StrSetSetup *setup
+);
+
+// Представление операции без создания результата. Обход тем же протоколом,
+// что strset_each(), но наборы только читаются: SSA_remove не удаляет ключ
+// и обход продолжается как после SSA_next. Любое другое значение
+// останавливает обход.
+
+typedef enum StrSetViewOp {
+    SSV_difference,
+    SSV_intersection,
+    SSV_union,
+    SSV_symmetric_difference,
+} StrSetViewOp;
+
+typedef struct StrSetView {
+    StrSet          *a, *b;
+    StrSetViewOp    op;
+} StrSetView;
+
+StrSetView strset_view_difference(StrSet *a, StrSet *b);
+StrSetView strset_view_intersection(StrSet *a, StrSet *b);
+StrSetView strset_view_union(StrSet *a, StrSet *b);
+StrSetView strset_view_symmetric_difference(StrSet *a, StrSet *b);
+
+bool strset_view_exist(StrSetView *view, const char *key);
+size_t strset_view_count(StrSetView *view);
+void strset_view_each(
+    StrSetView *view, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+);
+
+// Только размер результата
+size_t strset_difference_count(StrSet *a, StrSet *b);
+size_t strset_intersection_count(StrSet *a, StrSet *b);
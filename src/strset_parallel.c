@@ -0,0 +1,1099 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_parallel.h"
+
+#include "strset_hash.h"
+#include "strset_io.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// {{{ Потоки
+
+struct Worker {
+    pthread_t   thread;
+    void        (*func)(void *ctx, int index);
+    void        *ctx;
+    int         index;
+};
+
+static void *worker_run(void *arg) {
+    struct Worker *w = arg;
+    w->func(w->ctx, w->index);
+    return NULL;
+}
+
+// Вызвать func(ctx, i) для i из [0, threads_num) в отдельных потоках
+static void parallel_run(
+    int threads_num, void (*func)(void *ctx, int index), void *ctx
+) {
+    if (threads_num == 1) {
+        func(ctx, 0);
+        return;
+    }
+
+    struct Worker *workers = calloc(threads_num, sizeof(workers[0]));
+    assert(workers);
+    for (int i = 0; i < threads_num; i++) {
+        workers[i] = (struct Worker) {
+            .func = func,
+            .ctx = ctx,
+            .index = i,
+        };
+        pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+    }
+    for (int i = 0; i < threads_num; i++)
+        pthread_join(workers[i].thread, NULL);
+    free(workers);
+}
+
+int strset_threads_num_default() {
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    return num > 0 ? num : 1;
+}
+
+static int threads_num_get(int threads_num) {
+    return threads_num > 0 ? threads_num : strset_threads_num_default();
+}
+
+static inline size_t range_from(size_t num, int index, int parts_num) {
+    return num * index / parts_num;
+}
+
+// }}}
+
+// {{{ Разбиение по хэшу
+
+// Ключи и их хэши, переставленные так, что часть p лежит в
+// [start[p], start[p + 1])
+struct Partition {
+    char        **keys;
+    uint64_t    *hashes;
+    size_t      *start;
+    int         parts_num, bits;
+};
+
+struct PartitionCtx {
+    struct Partition    *part;
+    char                **keys;
+    size_t              keys_num;
+    uint64_t            *hashes;
+    // hist[t * parts_num + p], после префиксных сумм - смещения записи
+    size_t              *hist;
+    HashFunction        hasher;
+    int                 threads_num;
+};
+
+static void partition_hash(void *arg, int t) {
+    struct PartitionCtx *ctx = arg;
+    struct Partition *part = ctx->part;
+    size_t from = range_from(ctx->keys_num, t, ctx->threads_num),
+           to = range_from(ctx->keys_num, t + 1, ctx->threads_num);
+    size_t *hist = &ctx->hist[(size_t)t * part->parts_num];
+
+    for (size_t i = from; i < to; i++) {
+        uint64_t h = strset_hash_str(ctx->hasher, ctx->keys[i]);
+        ctx->hashes[i] = h;
+        hist[strset_hash_part(h, part->bits)]++;
+    }
+}
+
+static void partition_scatter(void *arg, int t) {
+    struct PartitionCtx *ctx = arg;
+    struct Partition *part = ctx->part;
+    size_t from = range_from(ctx->keys_num, t, ctx->threads_num),
+           to = range_from(ctx->keys_num, t + 1, ctx->threads_num);
+    size_t *offset = &ctx->hist[(size_t)t * part->parts_num];
+
+    for (size_t i = from; i < to; i++) {
+        uint64_t h = ctx->hashes[i];
+        size_t j = offset[strset_hash_part(h, part->bits)]++;
+        part->keys[j] = ctx->keys[i];
+        part->hashes[j] = h;
+    }
+}
+
+static void partition_build(
+    struct Partition *part, char **keys, size_t keys_num,
+    HashFunction hasher, int parts_num, int threads_num
+) {
+    assert((parts_num & (parts_num - 1)) == 0);
+
+    part->parts_num = parts_num;
+    part->bits = 0;
+    while ((1 << part->bits) < parts_num)
+        part->bits++;
+
+    part->keys = malloc(sizeof(part->keys[0]) * (keys_num + 1));
+    part->hashes = malloc(sizeof(part->hashes[0]) * (keys_num + 1));
+    part->start = calloc(parts_num + 1, sizeof(part->start[0]));
+    assert(part->keys && part->hashes && part->start);
+
+    struct PartitionCtx ctx = {
+        .part = part,
+        .keys = keys,
+        .keys_num = keys_num,
+        .hashes = malloc(sizeof(uint64_t) * (keys_num + 1)),
+        .hist = calloc((size_t)threads_num * parts_num, sizeof(size_t)),
+        .hasher = hasher,
+        .threads_num = threads_num,
+    };
+    assert(ctx.hashes && ctx.hist);
+
+    parallel_run(threads_num, partition_hash, &ctx);
+
+    size_t offset = 0;
+    for (int p = 0; p < parts_num; p++) {
+        part->start[p] = offset;
+        for (int t = 0; t < threads_num; t++) {
+            size_t *cell = &ctx.hist[(size_t)t * parts_num + p];
+            size_t count = *cell;
+            *cell = offset;
+            offset += count;
+        }
+    }
+    part->start[parts_num] = offset;
+
+    parallel_run(threads_num, partition_scatter, &ctx);
+
+    free(ctx.hashes);
+    free(ctx.hist);
+}
+
+static void partition_free(struct Partition *part) {
+    free(part->keys);
+    free(part->hashes);
+    free(part->start);
+}
+
+// Число частей с запасом для балансировки между потоками
+static int parts_num_get(int threads_num) {
+    int parts_num = 1;
+    while (parts_num < threads_num * 8)
+        parts_num *= 2;
+    return parts_num;
+}
+
+// Убрать повторы в части, уникальные ключи сдвигаются в начало части.
+// Возвращает их число.
+static size_t partition_unique(struct Partition *part, int p) {
+    size_t from = part->start[p], num = part->start[p + 1] - from;
+    if (!num)
+        return 0;
+
+    size_t cap = 4;
+    while (cap < num * 2)
+        cap *= 2;
+    size_t mask = cap - 1;
+    // индекс уникального ключа + 1, 0 - пусто
+    size_t *index = calloc(cap, sizeof(index[0]));
+    assert(index);
+
+    char **keys = &part->keys[from];
+    uint64_t *hashes = &part->hashes[from];
+    size_t unique = 0;
+
+    for (size_t i = 0; i < num; i++) {
+        uint64_t h = hashes[i];
+        size_t j = h & mask;
+        bool found = false;
+
+        for (; index[j]; j = (j + 1) & mask) {
+            size_t k = index[j] - 1;
+            if (hashes[k] == h && !strcmp(keys[k], keys[i])) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            keys[unique] = keys[i];
+            hashes[unique] = h;
+            index[j] = ++unique;
+        }
+    }
+
+    free(index);
+    return unique;
+}
+
+// Индекс ключей части для проверки принадлежности
+struct PartIndex {
+    size_t      *slots, mask;
+    char        **keys;
+    uint64_t    *hashes;
+};
+
+static void part_index_build(
+    struct PartIndex *index, char **keys, uint64_t *hashes, size_t num
+) {
+    size_t cap = 4;
+    while (cap < num * 2)
+        cap *= 2;
+
+    index->mask = cap - 1;
+    index->keys = keys;
+    index->hashes = hashes;
+    index->slots = calloc(cap, sizeof(index->slots[0]));
+    assert(index->slots);
+
+    for (size_t i = 0; i < num; i++) {
+        size_t j = hashes[i] & index->mask;
+        while (index->slots[j])
+            j = (j + 1) & index->mask;
+        index->slots[j] = i + 1;
+    }
+}
+
+static bool part_index_exist(
+    struct PartIndex *index, const char *key, uint64_t h
+) {
+    size_t j = h & index->mask;
+    for (; index->slots[j]; j = (j + 1) & index->mask) {
+        size_t k = index->slots[j] - 1;
+        if (index->hashes[k] == h && !strcmp(index->keys[k], key))
+            return true;
+    }
+    return false;
+}
+
+static void part_index_free(struct PartIndex *index) {
+    free(index->slots);
+}
+
+struct KeysArray {
+    char    **keys;
+    size_t  num, cap;
+};
+
+static StrSetAction iter_collect(const char *key, void *udata) {
+    struct KeysArray *arr = udata;
+    if (arr->num == arr->cap) {
+        arr->cap = arr->cap ? arr->cap * 2 : 1024;
+        arr->keys = realloc(arr->keys, sizeof(arr->keys[0]) * arr->cap);
+        assert(arr->keys);
+    }
+    arr->keys[arr->num++] = (char*)key;
+    return SSA_next;
+}
+
+static struct KeysArray keys_collect(StrSet *set) {
+    struct KeysArray arr = {
+        .cap = strset_count(set) + 1,
+    };
+    arr.keys = malloc(sizeof(arr.keys[0]) * arr.cap);
+    assert(arr.keys);
+    strset_each(set, iter_collect, &arr);
+    return arr;
+}
+
+// }}}
+
+struct BuildCtx {
+    struct Partition    *part;
+    size_t              *unique;
+    StrSetSharded       *sharded;
+    int                 threads_num;
+};
+
+static void build_unique(void *arg, int t) {
+    struct BuildCtx *ctx = arg;
+    for (int p = t; p < ctx->part->parts_num; p += ctx->threads_num)
+        ctx->unique[p] = partition_unique(ctx->part, p);
+}
+
+StrSet *strset_build_parallel(
+    char **keys, size_t keys_num, struct StrSetSetup *setup, int threads_num
+) {
+    assert(keys || !keys_num);
+
+    threads_num = threads_num_get(threads_num);
+    HashFunction hasher = strset_hasher_default(setup ? setup->hasher : NULL);
+
+    struct Partition part = {};
+    partition_build(
+        &part, keys, keys_num, hasher, parts_num_get(threads_num), threads_num
+    );
+
+    struct BuildCtx ctx = {
+        .part = &part,
+        .unique = calloc(part.parts_num, sizeof(size_t)),
+        .threads_num = threads_num,
+    };
+    assert(ctx.unique);
+    parallel_run(threads_num, build_unique, &ctx);
+
+    size_t unique = 0;
+    for (int p = 0; p < part.parts_num; p++)
+        unique += ctx.unique[p];
+
+    struct StrSetSetup set_setup = {
+        .capacity = setup && setup->capacity > unique ?
+            setup->capacity : unique,
+        .hasher = hasher,
+    };
+    StrSet *set = strset_new(&set_setup);
+    assert(set);
+
+    // единственный последовательный шаг, см. strset_parallel.h
+    for (int p = 0; p < part.parts_num; p++) {
+        char **part_keys = &part.keys[part.start[p]];
+        for (size_t i = 0; i < ctx.unique[p]; i++)
+            strset_add(set, part_keys[i]);
+    }
+
+    free(ctx.unique);
+    partition_free(&part);
+    return set;
+}
+
+static void build_shards(void *arg, int t) {
+    struct BuildCtx *ctx = arg;
+    struct Partition *part = ctx->part;
+
+    for (int p = t; p < part->parts_num; p += ctx->threads_num) {
+        StrSet *shard = strset_sharded_shard(ctx->sharded, p);
+        for (size_t i = part->start[p]; i < part->start[p + 1]; i++)
+            strset_add(shard, part->keys[i]);
+        strset_sharded_shard_sync(ctx->sharded, p);
+    }
+}
+
+StrSetSharded *strset_sharded_build_parallel(
+    char **keys, size_t keys_num, struct StrSetShardedSetup *setup,
+    int threads_num
+) {
+    assert(keys || !keys_num);
+
+    threads_num = threads_num_get(threads_num);
+
+    StrSetSharded *sharded = strset_sharded_new(setup);
+    int shards_num = strset_sharded_shards_num(sharded);
+
+    struct Partition part = {};
+    partition_build(
+        &part, keys, keys_num, strset_sharded_hasher(sharded),
+        shards_num, threads_num
+    );
+
+    struct BuildCtx ctx = {
+        .part = &part,
+        .sharded = sharded,
+        .threads_num = threads_num < shards_num ? threads_num : shards_num,
+    };
+    parallel_run(ctx.threads_num, build_shards, &ctx);
+
+    partition_free(&part);
+    return sharded;
+}
+
+// {{{ Операции над множествами
+
+enum SetOp {
+    SO_difference,
+    SO_intersection,
+    SO_union,
+};
+
+struct SetOpCtx {
+    struct Partition    *a, *b;
+    StrSetSharded       *result;
+    enum SetOp          op;
+    int                 threads_num;
+    // сколько ключей результата лежит в начале части a и части b
+    size_t              *a_num, *b_num;
+};
+
+// Ключи результата сдвигаются в начало своих частей
+static void set_op_part(struct SetOpCtx *ctx, int p) {
+    struct Partition *a = ctx->a, *b = ctx->b;
+    size_t a_from = a->start[p], a_num = a->start[p + 1] - a_from,
+           b_from = b->start[p], b_num = b->start[p + 1] - b_from;
+    char **a_keys = &a->keys[a_from], **b_keys = &b->keys[b_from];
+    uint64_t *a_hashes = &a->hashes[a_from], *b_hashes = &b->hashes[b_from];
+
+    struct PartIndex index = {};
+    size_t num = 0;
+
+    switch (ctx->op) {
+        case SO_difference:
+        case SO_intersection: {
+            bool keep_common = ctx->op == SO_intersection;
+            part_index_build(&index, b_keys, b_hashes, b_num);
+            for (size_t i = 0; i < a_num; i++) {
+                bool common = part_index_exist(&index, a_keys[i], a_hashes[i]);
+                if (common == keep_common)
+                    a_keys[num++] = a_keys[i];
+            }
+            ctx->a_num[p] = num;
+            ctx->b_num[p] = 0;
+            break;
+        }
+        case SO_union:
+            part_index_build(&index, a_keys, a_hashes, a_num);
+            for (size_t i = 0; i < b_num; i++) {
+                if (!part_index_exist(&index, b_keys[i], b_hashes[i]))
+                    b_keys[num++] = b_keys[i];
+            }
+            ctx->a_num[p] = a_num;
+            ctx->b_num[p] = num;
+            break;
+    }
+
+    part_index_free(&index);
+}
+
+// Часть p совпадает с шардом p результата, шард пишет только этот поток
+static void set_op_worker(void *arg, int t) {
+    struct SetOpCtx *ctx = arg;
+    for (int p = t; p < ctx->a->parts_num; p += ctx->threads_num) {
+        set_op_part(ctx, p);
+
+        StrSet *shard = strset_sharded_shard(ctx->result, p);
+        char **a_keys = &ctx->a->keys[ctx->a->start[p]],
+             **b_keys = &ctx->b->keys[ctx->b->start[p]];
+        for (size_t i = 0; i < ctx->a_num[p]; i++)
+            strset_add(shard, a_keys[i]);
+        for (size_t i = 0; i < ctx->b_num[p]; i++)
+            strset_add(shard, b_keys[i]);
+        strset_sharded_shard_sync(ctx->result, p);
+    }
+}
+
+struct CollectCtx {
+    StrSet              *sets[2];
+    struct KeysArray    arrs[2];
+    int                 threads_num;
+};
+
+static void collect_worker(void *arg, int t) {
+    struct CollectCtx *ctx = arg;
+    for (int i = t; i < 2; i += ctx->threads_num)
+        ctx->arrs[i] = keys_collect(ctx->sets[i]);
+}
+
+static StrSetSharded *set_op_parallel(
+    StrSet *a, StrSet *b, struct StrSetShardedSetup *setup, enum SetOp op,
+    int threads_num
+) {
+    assert(a);
+    assert(b);
+
+    threads_num = threads_num_get(threads_num);
+    StrSetSharded *result = strset_sharded_new(setup);
+    int parts_num = strset_sharded_shards_num(result);
+    HashFunction hasher = strset_sharded_hasher(result);
+
+    // обход StrSet только последовательный, наборы обходятся одновременно
+    struct CollectCtx collect = {
+        .sets = { a, b },
+        .threads_num = threads_num < 2 ? threads_num : 2,
+    };
+    parallel_run(collect.threads_num, collect_worker, &collect);
+
+    struct Partition a_part = {}, b_part = {};
+    partition_build(
+        &a_part, collect.arrs[0].keys, collect.arrs[0].num, hasher,
+        parts_num, threads_num
+    );
+    partition_build(
+        &b_part, collect.arrs[1].keys, collect.arrs[1].num, hasher,
+        parts_num, threads_num
+    );
+    free(collect.arrs[0].keys);
+    free(collect.arrs[1].keys);
+
+    struct SetOpCtx ctx = {
+        .a = &a_part,
+        .b = &b_part,
+        .result = result,
+        .op = op,
+        .threads_num = threads_num < parts_num ? threads_num : parts_num,
+        .a_num = calloc(parts_num, sizeof(size_t)),
+        .b_num = calloc(parts_num, sizeof(size_t)),
+    };
+    assert(ctx.a_num && ctx.b_num);
+    parallel_run(ctx.threads_num, set_op_worker, &ctx);
+
+    free(ctx.a_num);
+    free(ctx.b_num);
+    partition_free(&a_part);
+    partition_free(&b_part);
+    return result;
+}
+
+StrSetSharded *strset_difference_parallel(
+    StrSet *a, StrSet *b, struct StrSetShardedSetup *setup, int threads_num
+) {
+    return set_op_parallel(a, b, setup, SO_difference, threads_num);
+}
+
+StrSetSharded *strset_intersection_parallel(
+    StrSet *a, StrSet *b, struct StrSetShardedSetup *setup, int threads_num
+) {
+    return set_op_parallel(a, b, setup, SO_intersection, threads_num);
+}
+
+StrSetSharded *strset_union_parallel(
+    StrSet *a, StrSet *b, struct StrSetShardedSetup *setup, int threads_num
+) {
+    return set_op_parallel(a, b, setup, SO_union, threads_num);
+}
+
+struct ShardedOpCtx {
+    StrSetSharded   *a, *b, *result;
+    enum SetOp      op;
+    int             threads_num;
+};
+
+struct ShardOpCtx {
+    StrSet  *other, *dst;
+};
+
+static StrSetAction iter_shard_missing(const char *key, void *udata) {
+    struct ShardOpCtx *ctx = udata;
+    if (!strset_exist(ctx->other, key))
+        strset_add(ctx->dst, key);
+    return SSA_next;
+}
+
+static StrSetAction iter_shard_common(const char *key, void *udata) {
+    struct ShardOpCtx *ctx = udata;
+    if (strset_exist(ctx->other, key))
+        strset_add(ctx->dst, key);
+    return SSA_next;
+}
+
+static StrSetAction iter_shard_add(const char *key, void *udata) {
+    struct ShardOpCtx *ctx = udata;
+    strset_add(ctx->dst, key);
+    return SSA_next;
+}
+
+static void sharded_op_worker(void *arg, int t) {
+    struct ShardedOpCtx *ctx = arg;
+    int shards_num = strset_sharded_shards_num(ctx->a);
+
+    for (int i = t; i < shards_num; i += ctx->threads_num) {
+        StrSet *a = strset_sharded_shard(ctx->a, i),
+               *b = strset_sharded_shard(ctx->b, i),
+               *dst = strset_sharded_shard(ctx->result, i);
+
+        switch (ctx->op) {
+            case SO_difference:
+                strset_each(a, iter_shard_missing, &(struct ShardOpCtx) {
+                    .other = b,
+                    .dst = dst,
+                });
+                break;
+            case SO_intersection:
+                strset_each(a, iter_shard_common, &(struct ShardOpCtx) {
+                    .other = b,
+                    .dst = dst,
+                });
+                break;
+            case SO_union:
+                strset_each(a, iter_shard_add, &(struct ShardOpCtx) {
+                    .dst = dst,
+                });
+                strset_each(b, iter_shard_missing, &(struct ShardOpCtx) {
+                    .other = a,
+                    .dst = dst,
+                });
+                break;
+        }
+        strset_sharded_shard_sync(ctx->result, i);
+    }
+}
+
+static StrSetSharded *sharded_op(
+    StrSetSharded *a, StrSetSharded *b, enum SetOp op, int threads_num
+) {
+    assert(a);
+    assert(b);
+    // шарды должны совпадать
+    assert(strset_sharded_shards_num(a) == strset_sharded_shards_num(b));
+    assert(strset_sharded_hasher(a) == strset_sharded_hasher(b));
+
+    int shards_num = strset_sharded_shards_num(a);
+    StrSetSharded *result = strset_sharded_new(&(struct StrSetShardedSetup) {
+        .set = {
+            .hasher = strset_sharded_hasher(a),
+        },
+        .shards_num = shards_num,
+    });
+
+    threads_num = threads_num_get(threads_num);
+    struct ShardedOpCtx ctx = {
+        .a = a,
+        .b = b,
+        .result = result,
+        .op = op,
+        .threads_num = threads_num < shards_num ? threads_num : shards_num,
+    };
+    parallel_run(ctx.threads_num, sharded_op_worker, &ctx);
+    return result;
+}
+
+StrSetSharded *strset_sharded_difference(
+    StrSetSharded *a, StrSetSharded *b, int threads_num
+) {
+    return sharded_op(a, b, SO_difference, threads_num);
+}
+
+StrSetSharded *strset_sharded_intersection(
+    StrSetSharded *a, StrSetSharded *b, int threads_num
+) {
+    return sharded_op(a, b, SO_intersection, threads_num);
+}
+
+StrSetSharded *strset_sharded_union(
+    StrSetSharded *a, StrSetSharded *b, int threads_num
+) {
+    return sharded_op(a, b, SO_union, threads_num);
+}
+
+// }}}
+
+// {{{ Параллельный обход
+
+struct EachCtx {
+    struct KeysArray    keys;
+    StrSetAction        (*cb)(const char *key, void *udata);
+    void                **udata;
+    // отметки удаления по индексу ключа в keys
+    unsigned char       *remove;
+    // указатели помеченных ключей, открытая адресация, NULL - пусто
+    const char          **marked;
+    size_t              marked_mask, visited;
+    _Atomic bool        stop;
+    int                 threads_num;
+};
+
+static void each_worker(void *arg, int t) {
+    struct EachCtx *ctx = arg;
+    size_t from = range_from(ctx->keys.num, t, ctx->threads_num),
+           to = range_from(ctx->keys.num, t + 1, ctx->threads_num);
+    void *udata = ctx->udata ? ctx->udata[t] : NULL;
+
+    for (size_t i = from; i < to; i++) {
+        if (atomic_load_explicit(&ctx->stop, memory_order_relaxed))
+            break;
+
+        StrSetAction action = ctx->cb(ctx->keys.keys[i], udata);
+        if (action == SSA_remove)
+            ctx->remove[i] = 1;
+        else if (action != SSA_next)
+            atomic_store_explicit(&ctx->stop, true, memory_order_relaxed);
+    }
+}
+
+static inline size_t marked_slot(struct EachCtx *ctx, const char *key) {
+    return strset_hash_mix((uintptr_t)key) & ctx->marked_mask;
+}
+
+// Индекс помеченных ключей по указателю: набор не менялся, strset_each()
+// отдает те же указатели, что и при снимке, но порядок обхода не важен
+static bool marked_build(struct EachCtx *ctx) {
+    size_t num = 0;
+    for (size_t i = 0; i < ctx->keys.num; i++)
+        num += ctx->remove[i];
+    if (!num)
+        return false;
+
+    size_t cap = 4;
+    while (cap < num * 2)
+        cap *= 2;
+    ctx->marked_mask = cap - 1;
+    ctx->marked = calloc(cap, sizeof(ctx->marked[0]));
+    assert(ctx->marked);
+
+    for (size_t i = 0; i < ctx->keys.num; i++) {
+        if (!ctx->remove[i])
+            continue;
+        size_t j = marked_slot(ctx, ctx->keys.keys[i]);
+        while (ctx->marked[j])
+            j = (j + 1) & ctx->marked_mask;
+        ctx->marked[j] = ctx->keys.keys[i];
+    }
+    return true;
+}
+
+static StrSetAction iter_remove_marked(const char *key, void *udata) {
+    struct EachCtx *ctx = udata;
+    // набор не должен был вырасти после снимка
+    assert(ctx->visited < ctx->keys.num);
+    ctx->visited++;
+
+    for (size_t j = marked_slot(ctx, key); ctx->marked[j];
+         j = (j + 1) & ctx->marked_mask)
+        if (ctx->marked[j] == key)
+            return SSA_remove;
+    return SSA_next;
+}
+
+void strset_each_parallel(
+    StrSet *set, int threads_num,
+    StrSetAction (*cb)(const char *key, void *udata), void **udata_per_thread
+) {
+    assert(set);
+    assert(cb);
+
+    struct EachCtx ctx = {
+        .keys = keys_collect(set),
+        .cb = cb,
+        .udata = udata_per_thread,
+        .threads_num = threads_num_get(threads_num),
+    };
+    ctx.remove = calloc(ctx.keys.num + 1, sizeof(ctx.remove[0]));
+    assert(ctx.remove);
+
+    parallel_run(ctx.threads_num, each_worker, &ctx);
+
+    if (marked_build(&ctx))
+        strset_each(set, iter_remove_marked, &ctx);
+
+    free(ctx.marked);
+    free(ctx.remove);
+    free(ctx.keys.keys);
+}
+
+// }}}
+
+// {{{ Чтение файлов
+
+#define INGEST_CHUNK_SIZE   (4 * 1024 * 1024)
+// сколько дочитывать за раз для строки за границей блока
+#define INGEST_TAIL_SIZE    (64 * 1024)
+
+struct IngestFile {
+    int             fd;
+    bool            regular;
+    // ошибка открытия или чтения любого блока файла
+    atomic_bool     failed;
+};
+
+struct IngestChunk {
+    int     file;
+    // [start, end) в файле
+    off_t   start, end;
+};
+
+struct IngestThread {
+    char    *buf;
+    size_t  cap;
+    size_t  bytes, lines;
+} __attribute__((aligned(64)));
+
+struct IngestCtx {
+    struct IngestFile   *files;
+    struct IngestChunk  *chunks;
+    size_t              chunks_num;
+    _Atomic size_t      next;
+    atomic_bool         stop;
+
+    uint32_t            flags;
+    bool                (*cb)(char *line, size_t len, void *udata);
+    void                **udata_per_thread;
+    struct IngestThread *threads;
+};
+
+struct IngestLine {
+    struct IngestCtx    *ctx;
+    int                 index;
+};
+
+// Строка до обрезки
+static bool ingest_line(
+    struct IngestCtx *ctx, int index, char *line, size_t len
+) {
+    struct IngestThread *thread = &ctx->threads[index];
+    if (!strset_line_trim(&line, &len, ctx->flags))
+        return true;
+    thread->lines++;
+
+    void *udata = ctx->udata_per_thread ? ctx->udata_per_thread[index] : NULL;
+    if (!ctx->cb(line, len, udata)) {
+        atomic_store(&ctx->stop, true);
+        return false;
+    }
+    return !atomic_load_explicit(&ctx->stop, memory_order_relaxed);
+}
+
+static bool ingest_stream_line(char *line, size_t len, void *udata) {
+    struct IngestLine *il = udata;
+    il->ctx->threads[il->index].bytes += len + 1;
+    return ingest_line(il->ctx, il->index, line, len);
+}
+
+// Дочитать до len байт в buf с позиции pos. Возвращает прочитанное число
+// байт, меньше len только в конце файла, -1 при ошибке.
+static ssize_t pread_full(int fd, char *buf, size_t len, off_t pos) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t got = pread(fd, buf + done, len - done, pos + done);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (!got)
+            break;
+        done += got;
+    }
+    return done;
+}
+
+static void thread_buf_reserve(struct IngestThread *thread, size_t cap) {
+    if (thread->cap >= cap)
+        return;
+    thread->cap = cap;
+    thread->buf = realloc(thread->buf, cap + 1);
+    assert(thread->buf);
+}
+
+static void ingest_chunk(
+    struct IngestCtx *ctx, int index, struct IngestChunk *chunk
+) {
+    struct IngestThread *thread = &ctx->threads[index];
+    int fd = ctx->files[chunk->file].fd;
+
+    // с предыдущего байта, чтобы знать, начинается ли строка ровно на
+    // границе блока
+    off_t pos = chunk->start ? chunk->start - 1 : 0;
+    size_t own = chunk->end - pos;
+    thread_buf_reserve(thread, own);
+
+    ssize_t got = pread_full(fd, thread->buf, own, pos);
+    if (got < 0) {
+        atomic_store(&ctx->files[chunk->file].failed, true);
+        return;
+    }
+    size_t len = got, line = 0;
+
+    if (chunk->start) {
+        char *nl = memchr(thread->buf, '\n', len);
+        if (!nl)
+            return;
+        line = nl - thread->buf + 1;
+    }
+
+    while (line < own) {
+        char *nl = memchr(thread->buf + line, '\n', len - line);
+
+        // последняя строка блока выходит за его границу
+        while (!nl) {
+            thread_buf_reserve(thread, len + INGEST_TAIL_SIZE);
+            got = pread_full(fd, thread->buf + len, INGEST_TAIL_SIZE, pos + len);
+            if (got < 0) {
+                atomic_store(&ctx->files[chunk->file].failed, true);
+                return;
+            }
+            if (!got) {
+                // конец файла без '\n'
+                if (len > line) {
+                    thread->buf[len] = 0;
+                    ingest_line(ctx, index, thread->buf + line, len - line);
+                }
+                return;
+            }
+            nl = memchr(thread->buf + len, '\n', got);
+            len += got;
+        }
+
+        *nl = 0;
+        char *start = thread->buf + line;
+        if (!ingest_line(ctx, index, start, nl - start))
+            return;
+        line = nl - thread->buf + 1;
+    }
+}
+
+static void ingest_worker(void *arg, int index) {
+    struct IngestCtx *ctx = arg;
+    struct IngestThread *thread = &ctx->threads[index];
+
+    while (!atomic_load_explicit(&ctx->stop, memory_order_relaxed)) {
+        size_t i = atomic_fetch_add(&ctx->next, 1);
+        if (i >= ctx->chunks_num)
+            break;
+
+        struct IngestChunk *chunk = &ctx->chunks[i];
+        if (ctx->files[chunk->file].regular) {
+            thread->bytes += chunk->end - chunk->start;
+            ingest_chunk(ctx, index, chunk);
+            continue;
+        }
+
+        struct IngestLine il = {
+            .ctx = ctx,
+            .index = index,
+        };
+        int fd = ctx->files[chunk->file].fd;
+        if (!strset_fd_each_line(fd, 0, ingest_stream_line, &il))
+            atomic_store(&ctx->files[chunk->file].failed, true);
+    }
+}
+
+bool strset_files_each_line_parallel(
+    const char **paths, size_t paths_num, struct StrSetIngestSetup *setup,
+    bool (*cb)(char *line, size_t len, void *udata), void **udata_per_thread,
+    struct StrSetIngestStats *stats
+) {
+    assert(paths || !paths_num);
+    assert(cb);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double start = ts.tv_sec + ts.tv_nsec / 1e9;
+
+    size_t chunk_size = setup && setup->chunk_size ?
+        setup->chunk_size : INGEST_CHUNK_SIZE;
+    struct IngestCtx ctx = {
+        .files = calloc(paths_num + 1, sizeof(ctx.files[0])),
+        .flags = setup ? setup->flags : 0,
+        .cb = cb,
+        .udata_per_thread = udata_per_thread,
+    };
+    assert(ctx.files);
+
+    size_t chunks_cap = 0;
+    for (size_t i = 0; i < paths_num; i++) {
+        struct IngestFile *file = &ctx.files[i];
+        struct stat st;
+        file->fd = open(paths[i], O_RDONLY | O_CLOEXEC);
+        if (file->fd < 0 || fstat(file->fd, &st)) {
+            atomic_init(&file->failed, true);
+            continue;
+        }
+
+        file->regular = S_ISREG(st.st_mode);
+        size_t chunks_num = 1;
+        if (file->regular) {
+            if (!st.st_size)
+                continue;
+            chunks_num = (st.st_size + chunk_size - 1) / chunk_size;
+            posix_fadvise(file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+
+        if (ctx.chunks_num + chunks_num > chunks_cap) {
+            chunks_cap = (ctx.chunks_num + chunks_num) * 2;
+            ctx.chunks = realloc(
+                ctx.chunks, sizeof(ctx.chunks[0]) * chunks_cap
+            );
+            assert(ctx.chunks);
+        }
+        for (size_t j = 0; j < chunks_num; j++) {
+            off_t chunk_start = j * chunk_size, chunk_end = chunk_start;
+            if (file->regular) {
+                chunk_end = chunk_start + chunk_size;
+                if (chunk_end > st.st_size)
+                    chunk_end = st.st_size;
+            }
+            ctx.chunks[ctx.chunks_num++] = (struct IngestChunk) {
+                .file = i,
+                .start = chunk_start,
+                .end = chunk_end,
+            };
+        }
+    }
+
+    int threads_num = threads_num_get(setup ? setup->threads_num : 0);
+    if ((size_t)threads_num > ctx.chunks_num)
+        threads_num = ctx.chunks_num ? ctx.chunks_num : 1;
+    ctx.threads = calloc(threads_num, sizeof(ctx.threads[0]));
+    assert(ctx.threads);
+
+    parallel_run(threads_num, ingest_worker, &ctx);
+
+    size_t bytes = 0, lines = 0;
+    for (int t = 0; t < threads_num; t++) {
+        bytes += ctx.threads[t].bytes;
+        lines += ctx.threads[t].lines;
+        free(ctx.threads[t].buf);
+    }
+    // файл с несколькими неудачными блоками считается один раз
+    size_t files_failed = 0;
+    for (size_t i = 0; i < paths_num; i++) {
+        files_failed += atomic_load(&ctx.files[i].failed);
+        if (ctx.files[i].fd >= 0)
+            close(ctx.files[i].fd);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double seconds = ts.tv_sec + ts.tv_nsec / 1e9 - start;
+    if (stats) {
+        *stats = (struct StrSetIngestStats) {
+            .files_num = paths_num,
+            .files_failed = files_failed,
+            .bytes = bytes,
+            .lines = lines,
+            .seconds = seconds,
+            .mb_per_sec = seconds > 0. ? bytes / seconds / (1024 * 1024) : 0.,
+        };
+    }
+
+    free(ctx.threads);
+    free(ctx.chunks);
+    free(ctx.files);
+    return !files_failed;
+}
+
+static bool line_add_sharded(char *line, size_t len, void *udata) {
+    strset_sharded_add(udata, line);
+    return true;
+}
+
+static bool line_add_atomic(char *line, size_t len, void *udata) {
+    strset_atomic_add(udata, line);
+    return true;
+}
+
+static bool add_files(
+    void *set, bool (*cb)(char *line, size_t len, void *udata),
+    const char **paths, size_t paths_num,
+    struct StrSetIngestSetup *setup, struct StrSetIngestStats *stats
+) {
+    int threads_num = threads_num_get(setup ? setup->threads_num : 0);
+    void **udata = malloc(sizeof(udata[0]) * threads_num);
+    assert(udata);
+    for (int t = 0; t < threads_num; t++)
+        udata[t] = set;
+
+    struct StrSetIngestSetup ingest = setup ? *setup :
+        (struct StrSetIngestSetup) {};
+    ingest.threads_num = threads_num;
+
+    bool ok = strset_files_each_line_parallel(
+        paths, paths_num, &ingest, cb, udata, stats
+    );
+    free(udata);
+    return ok;
+}
+
+bool strset_sharded_add_files(
+    StrSetSharded *set, const char **paths, size_t paths_num,
+    struct StrSetIngestSetup *setup, struct StrSetIngestStats *stats
+) {
+    assert(set);
+    return add_files(set, line_add_sharded, paths, paths_num, setup, stats);
+}
+
+bool strset_atomic_add_files(
+    StrSetAtomic *set, const char **paths, size_t paths_num,
+    struct StrSetIngestSetup *setup, struct StrSetIngestStats *stats
+) {
+    assert(set);
+    return add_files(set, line_add_atomic, paths, paths_num, setup, stats);
+}
+
+// }}}
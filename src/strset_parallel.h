@@ -0,0 +1,116 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include "strset_atomic.h"
+#include "strset_sharded.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// threads_num == 0 во всех функциях - по числу процессоров
+int strset_threads_num_default();
+
+// Построить набор из массива строк на всех ядрах. Хэши считаются
+// параллельно, ключи разбиваются на части по хэшу, повторы убираются в
+// каждой части своим потоком. Итоговый StrSet создается сразу нужного
+// размера, но заполняется одним потоком: в один StrSet нельзя писать
+// параллельно, и на большом числе уникальных ключей ускорение упирается в
+// это заполнение. Для масштабирования на все ядра -
+// strset_sharded_build_parallel().
+StrSet *strset_build_parallel(
+    char **keys, size_t keys_num, struct StrSetSetup *setup, int threads_num
+);
+
+// То же, но части совпадают с шардами и каждый шард заполняется своим
+// потоком без блокировок, последовательного шага нет
+StrSetSharded *strset_sharded_build_parallel(
+    char **keys, size_t keys_num, struct StrSetShardedSetup *setup,
+    int threads_num
+);
+
+// Операции над множествами по частям хэша. Ключи обоих наборов
+// раскладываются по частям, совпадающим с шардами результата, каждая часть
+// обрабатывается и записывается в свой шард одним потоком без блокировок.
+// Результат шардированный, потому что один StrSet заполняется только
+// последовательно. Последовательным остается обход a и b, он только
+// копирует указатели на ключи, наборы обходятся одновременно. Ключи
+// совпадают с strset_difference() и strset_ops.h. setup задает hasher и
+// число шардов результата, может быть NULL.
+StrSetSharded *strset_difference_parallel(
+    StrSet *a, StrSet *b, struct StrSetShardedSetup *setup, int threads_num
+);
+StrSetSharded *strset_intersection_parallel(
+    StrSet *a, StrSet *b, struct StrSetShardedSetup *setup, int threads_num
+);
+StrSetSharded *strset_union_parallel(
+    StrSet *a, StrSet *b, struct StrSetShardedSetup *setup, int threads_num
+);
+
+// Для шардированных наборов с одинаковым числом шардов и hasher части уже
+// есть, каждая пара шардов обрабатывается своим потоком, результат
+// заполняется без блокировок. Входные наборы не должны меняться.
+StrSetSharded *strset_sharded_difference(
+    StrSetSharded *a, StrSetSharded *b, int threads_num
+);
+StrSetSharded *strset_sharded_intersection(
+    StrSetSharded *a, StrSetSharded *b, int threads_num
+);
+StrSetSharded *strset_sharded_union(
+    StrSetSharded *a, StrSetSharded *b, int threads_num
+);
+
+// Обход набора несколькими потоками. Ключи делятся на непрерывные диапазоны,
+// поток t вызывает cb с udata_per_thread[t] (или NULL, если массива нет).
+// SSA_remove не меняет набор во время обхода: ключи помечаются и удаляются
+// одним проходом после завершения всех потоков. Любое другое значение кроме
+// SSA_next и SSA_remove останавливает все потоки, уже помеченные ключи
+// все равно удаляются. Набор нельзя менять из cb.
+void strset_each_parallel(
+    StrSet *set, int threads_num,
+    StrSetAction (*cb)(const char *key, void *udata), void **udata_per_thread
+);
+
+// {{{ Чтение файлов
+
+// Файлы режутся на блоки, блоки разбираются пулом потоков через pread().
+// Блоку принадлежат строки, которые начинаются внутри него: начало до
+// первого '\n' пропускается, последняя строка дочитывается за границей
+// блока. Файлы, которые не являются обычными (каналы), читаются целиком
+// одним потоком.
+struct StrSetIngestSetup {
+    // StrSetReadFlags из strset_io.h
+    uint32_t    flags;
+    int         threads_num;
+    // 0 - 4Мб
+    size_t      chunk_size;
+};
+
+struct StrSetIngestStats {
+    size_t  files_num, files_failed;
+    // прочитано байт и передано строк
+    size_t  bytes, lines;
+    double  seconds, mb_per_sec;
+};
+
+// cb вызывается одновременно из нескольких потоков, поток t получает
+// udata_per_thread[t] (или NULL). false из cb останавливает все потоки.
+// Возвращает false если какой-то файл не удалось открыть или прочитать,
+// остальные файлы при этом читаются. setup и stats могут быть NULL.
+bool strset_files_each_line_parallel(
+    const char **paths, size_t paths_num, struct StrSetIngestSetup *setup,
+    bool (*cb)(char *line, size_t len, void *udata), void **udata_per_thread,
+    struct StrSetIngestStats *stats
+);
+
+bool strset_sharded_add_files(
+    StrSetSharded *set, const char **paths, size_t paths_num,
+    struct StrSetIngestSetup *setup, struct StrSetIngestStats *stats
+);
+bool strset_atomic_add_files(
+    StrSetAtomic *set, const char **paths, size_t paths_num,
+    struct StrSetIngestSetup *setup, struct StrSetIngestStats *stats
+);
+
+// }}}
@@ -0,0 +1,209 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_sharded.h"
+
+#include "strset_hash.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SHARDS_NUM_DEFAULT  64
+
+// Каждый шард на своей кэш-линии, что-бы блокировки соседей не делили линию
+struct Shard {
+    pthread_mutex_t     lock;
+    StrSet              *set;
+    _Atomic size_t      count;
+} __attribute__((aligned(64)));
+
+struct StrSetSharded {
+    struct Shard    *shards;
+    int             shards_num, bits;
+    HashFunction    hasher;
+};
+
+static inline struct Shard *shard_get(StrSetSharded *set, const char *key) {
+    uint64_t h = strset_hash_str(set->hasher, key);
+    return &set->shards[strset_hash_part(h, set->bits)];
+}
+
+static inline void shard_count_update(struct Shard *shard) {
+    atomic_store_explicit(
+        &shard->count, strset_count(shard->set), memory_order_relaxed
+    );
+}
+
+StrSetSharded *strset_sharded_new(struct StrSetShardedSetup *setup) {
+    StrSetSharded *set = calloc(1, sizeof(*set));
+    assert(set);
+
+    int shards_num = setup && setup->shards_num ?
+        setup->shards_num : SHARDS_NUM_DEFAULT;
+    // только степень двойки
+    assert(shards_num > 0 && (shards_num & (shards_num - 1)) == 0);
+
+    int bits = 0;
+    while ((1 << bits) < shards_num)
+        bits++;
+
+    set->shards_num = shards_num;
+    set->bits = bits;
+    set->hasher = strset_hasher_default(setup ? setup->set.hasher : NULL);
+
+    set->shards = aligned_alloc(64, sizeof(set->shards[0]) * shards_num);
+    assert(set->shards);
+
+    struct StrSetSetup shard_setup = {
+        .capacity = setup ? setup->set.capacity / shards_num : 0,
+        .hasher = set->hasher,
+    };
+
+    for (int i = 0; i < shards_num; i++) {
+        struct Shard *shard = &set->shards[i];
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->set = strset_new(&shard_setup);
+        assert(shard->set);
+        atomic_init(&shard->count, 0);
+    }
+
+    return set;
+}
+
+void strset_sharded_free(StrSetSharded *set) {
+    if (!set)
+        return;
+
+    for (int i = 0; i < set->shards_num; i++) {
+        pthread_mutex_destroy(&set->shards[i].lock);
+        strset_free(set->shards[i].set);
+    }
+    free(set->shards);
+    free(set);
+}
+
+void strset_sharded_clear(StrSetSharded *set) {
+    assert(set);
+    for (int i = 0; i < set->shards_num; i++) {
+        struct Shard *shard = &set->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        strset_clear(shard->set);
+        shard_count_update(shard);
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+bool strset_sharded_add(StrSetSharded *set, const char *key) {
+    assert(set);
+    assert(key);
+
+    struct Shard *shard = shard_get(set, key);
+    pthread_mutex_lock(&shard->lock);
+    size_t count = strset_count(shard->set);
+    strset_add(shard->set, key);
+    bool added = strset_count(shard->set) != count;
+    if (added)
+        shard_count_update(shard);
+    pthread_mutex_unlock(&shard->lock);
+
+    return added;
+}
+
+bool strset_sharded_exist(StrSetSharded *set, const char *key) {
+    assert(set);
+    assert(key);
+
+    struct Shard *shard = shard_get(set, key);
+    pthread_mutex_lock(&shard->lock);
+    bool exist = strset_exist(shard->set, key);
+    pthread_mutex_unlock(&shard->lock);
+
+    return exist;
+}
+
+void strset_sharded_remove(StrSetSharded *set, const char *key) {
+    assert(set);
+    assert(key);
+
+    struct Shard *shard = shard_get(set, key);
+    pthread_mutex_lock(&shard->lock);
+    strset_remove(shard->set, key);
+    shard_count_update(shard);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+struct EachCtx {
+    StrSetAction    (*cb)(const char *key, void *udata);
+    void            *udata;
+    bool            stopped;
+};
+
+static StrSetAction iter_each(const char *key, void *udata) {
+    struct EachCtx *ctx = udata;
+    StrSetAction action = ctx->cb(key, ctx->udata);
+    if (action != SSA_next && action != SSA_remove)
+        ctx->stopped = true;
+    return action;
+}
+
+void strset_sharded_each(
+    StrSetSharded *set, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+) {
+    assert(set);
+    assert(cb);
+
+    // остановка в одном шарде останавливает весь обход
+    struct EachCtx ctx = {
+        .cb = cb,
+        .udata = udata,
+    };
+    for (int i = 0; i < set->shards_num && !ctx.stopped; i++) {
+        struct Shard *shard = &set->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        strset_each(shard->set, iter_each, &ctx);
+        shard_count_update(shard);
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+size_t strset_sharded_count(StrSetSharded *set) {
+    assert(set);
+
+    size_t count = 0;
+    for (int i = 0; i < set->shards_num; i++)
+        count += atomic_load_explicit(
+            &set->shards[i].count, memory_order_relaxed
+        );
+    return count;
+}
+
+int strset_sharded_shards_num(StrSetSharded *set) {
+    assert(set);
+    return set->shards_num;
+}
+
+int strset_sharded_shard_index(StrSetSharded *set, const char *key) {
+    assert(set);
+    return shard_get(set, key) - set->shards;
+}
+
+StrSet *strset_sharded_shard(StrSetSharded *set, int index) {
+    assert(set);
+    assert(index >= 0 && index < set->shards_num);
+    return set->shards[index].set;
+}
+
+void strset_sharded_shard_sync(StrSetSharded *set, int index) {
+    assert(set);
+    assert(index >= 0 && index < set->shards_num);
+    shard_count_update(&set->shards[index]);
+}
+
+HashFunction strset_sharded_hasher(StrSetSharded *set) {
+    assert(set);
+    return set->hasher;
+}
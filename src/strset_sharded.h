@@ -0,0 +1,45 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Набор из нескольких StrSet, ключ попадает в шард по старшим битам хэша.
+// У каждого шарда своя блокировка, поэтому потоки пишущие в разные шарды
+// не мешают друг другу.
+
+struct StrSetShardedSetup {
+    // hasher общий для всех шардов, capacity делится между шардами
+    struct StrSetSetup  set;
+    // степень двойки, 0 - значение по умолчанию
+    int                 shards_num;
+};
+
+typedef struct StrSetSharded StrSetSharded;
+
+StrSetSharded *strset_sharded_new(struct StrSetShardedSetup *setup);
+void strset_sharded_free(StrSetSharded *set);
+void strset_sharded_clear(StrSetSharded *set);
+// Возвращает true если ключ был добавлен, false если уже был в наборе
+bool strset_sharded_add(StrSetSharded *set, const char *key);
+bool strset_sharded_exist(StrSetSharded *set, const char *key);
+void strset_sharded_remove(StrSetSharded *set, const char *key);
+// Шарды обходятся по очереди, на время обхода шард заблокирован
+void strset_sharded_each(
+    StrSetSharded *set, StrSetAction (*cb)(const char *key, void *udata),
+    void *udata
+);
+// Без блокировок, сумма счетчиков шардов
+size_t strset_sharded_count(StrSetSharded *set);
+
+int strset_sharded_shards_num(StrSetSharded *set);
+int strset_sharded_shard_index(StrSetSharded *set, const char *key);
+// Доступ к шарду в обход блокировок, для однопоточных фаз. После
+// изменения шарда напрямую нужно обновить счетчик strset_sharded_shard_sync()
+StrSet *strset_sharded_shard(StrSetSharded *set, int index);
+void strset_sharded_shard_sync(StrSetSharded *set, int index);
+// Шард ключа - strset_hash_part() от strset_hash_str() с этим hasher
+HashFunction strset_sharded_hasher(StrSetSharded *set);
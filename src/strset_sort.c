@@ -0,0 +1,131 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_sort.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INSERTION_SORT_MAX  16
+
+static inline unsigned char char_at(const char *s, size_t depth) {
+    return (unsigned char)s[depth];
+}
+
+static inline void swap(const char **strs, size_t a, size_t b) {
+    const char *tmp = strs[a];
+    strs[a] = strs[b];
+    strs[b] = tmp;
+}
+
+// Первые depth символов у всех строк совпадают
+static void insertion_sort(const char **strs, size_t num, size_t depth) {
+    for (size_t i = 1; i < num; i++) {
+        const char *s = strs[i];
+        size_t j = i;
+        while (j > 0 && strcmp(strs[j - 1] + depth, s + depth) > 0) {
+            strs[j] = strs[j - 1];
+            j--;
+        }
+        strs[j] = s;
+    }
+}
+
+static inline unsigned char median3(
+    const char **strs, size_t num, size_t depth
+) {
+    unsigned char a = char_at(strs[0], depth),
+                  b = char_at(strs[num / 2], depth),
+                  c = char_at(strs[num - 1], depth);
+    if (a < b)
+        return b < c ? b : (a < c ? c : a);
+    return a < c ? a : (b < c ? c : b);
+}
+
+static void mkqsort(const char **strs, size_t num, size_t depth) {
+    while (num > INSERTION_SORT_MAX) {
+        unsigned char pivot = median3(strs, num, depth);
+
+        // [0, lt) < pivot, [lt, i) == pivot, (gt, num) > pivot
+        size_t lt = 0, i = 0, gt = num;
+        while (i < gt) {
+            unsigned char c = char_at(strs[i], depth);
+            if (c < pivot)
+                swap(strs, lt++, i++);
+            else if (c > pivot)
+                swap(strs, i, --gt);
+            else
+                i++;
+        }
+
+        mkqsort(strs, lt, depth);
+        mkqsort(strs + gt, num - gt, depth);
+
+        // равные по текущему символу - дальше со следующего символа,
+        // если символ не завершающий ноль
+        if (!pivot)
+            return;
+        strs += lt;
+        num = gt - lt;
+        depth++;
+    }
+    insertion_sort(strs, num, depth);
+}
+
+void strset_sort_strs(const char **strs, size_t num) {
+    assert(strs || !num);
+    mkqsort(strs, num, 0);
+}
+
+struct CollectCtx {
+    const char  **keys;
+    size_t      num;
+};
+
+static StrSetAction iter_collect(const char *key, void *udata) {
+    struct CollectCtx *ctx = udata;
+    ctx->keys[ctx->num++] = key;
+    return SSA_next;
+}
+
+const char **strset_to_sorted_array(StrSet *set, size_t *num) {
+    assert(set);
+
+    struct CollectCtx ctx = {
+        .keys = malloc(sizeof(ctx.keys[0]) * (strset_count(set) + 1)),
+    };
+    assert(ctx.keys);
+    strset_each(set, iter_collect, &ctx);
+    strset_sort_strs(ctx.keys, ctx.num);
+
+    if (num)
+        *num = ctx.num;
+    return ctx.keys;
+}
+
+char *strset_to_sorted_buf(StrSet *set, char sep, size_t *size) {
+    assert(set);
+
+    size_t num = 0;
+    const char **keys = strset_to_sorted_array(set, &num);
+
+    size_t len = 0;
+    for (size_t i = 0; i < num; i++)
+        len += strlen(keys[i]) + 1;
+
+    char *buf = malloc(len + 1), *p = buf;
+    assert(buf);
+    for (size_t i = 0; i < num; i++) {
+        size_t key_len = strlen(keys[i]);
+        memcpy(p, keys[i], key_len);
+        p += key_len;
+        *p++ = sep;
+    }
+    *p = 0;
+
+    free(keys);
+    if (size)
+        *size = len;
+    return buf;
+}
@@ -0,0 +1,19 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include <stddef.h>
+
+// Сортировка строк многоключевой быстрой сортировкой (Bentley-Sedgewick):
+// символы сравниваются по одному с текущей глубины, общий префикс не
+// сравнивается повторно. Порядок совпадает с strcmp().
+void strset_sort_strs(const char **strs, size_t num);
+
+// Ключи набора по возрастанию. Указатели смотрят в набор и действительны до
+// его изменения, массив освобождает вызывающий.
+const char **strset_to_sorted_array(StrSet *set, size_t *num);
+
+// Ключи по возрастанию в одном буфере, каждый ключ завершается sep
+// ('\n' для вывода в файл или '\0'). В size - длина без завершающего нуля.
+char *strset_to_sorted_buf(StrSet *set, char sep, size_t *size);
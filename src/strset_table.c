@@ -0,0 +1,301 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strset_table.h"
+
+#include "strset_hash.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_CHUNK_SIZE    (64 * 1024)
+#define CAPACITY_MIN        16
+
+// {{{ Арена строк
+
+struct StrArenaChunk {
+    struct StrArenaChunk    *next;
+    size_t                  used, cap;
+    char                    data[];
+};
+
+const char *strarena_strdup(StrArena *arena, const char *key, size_t len) {
+    assert(arena);
+    assert(key);
+
+    struct StrArenaChunk *chunk = arena->chunks;
+    if (!chunk || chunk->used + len + 1 > chunk->cap) {
+        size_t cap = len + 1 > ARENA_CHUNK_SIZE ? len + 1 : ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(*chunk) + cap);
+        assert(chunk);
+        chunk->next = arena->chunks;
+        chunk->used = 0;
+        chunk->cap = cap;
+        arena->chunks = chunk;
+    }
+
+    char *copy = chunk->data + chunk->used;
+    memcpy(copy, key, len);
+    copy[len] = 0;
+    chunk->used += len + 1;
+    arena->used += len + 1;
+    return copy;
+}
+
+void strarena_free(StrArena *arena) {
+    assert(arena);
+    struct StrArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        struct StrArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->used = 0;
+}
+
+// }}}
+
+struct Slot {
+    // 0 - пустой слот
+    uint64_t    hash;
+    const char  *key;
+    size_t      len;
+    // дальше значение с t->value_offset
+};
+
+static inline struct Slot *slot_at(StrTable *t, size_t i) {
+    return (struct Slot*)(t->slots + i * t->slot_size);
+}
+
+static inline void *slot_value(StrTable *t, struct Slot *slot) {
+    return (uint8_t*)slot + t->value_offset;
+}
+
+static inline size_t align_up(size_t size, size_t align) {
+    return (size + align - 1) & ~(align - 1);
+}
+
+static inline uint64_t key_hash(StrTable *t, const char *key, size_t len) {
+    uint64_t h = strset_hash(t->hasher, key, len);
+    return h ? h : 1;
+}
+
+static void slots_alloc(StrTable *t, size_t cap) {
+    t->cap = cap;
+    t->slots = calloc(cap, t->slot_size);
+    assert(t->slots);
+}
+
+void strtable_init(StrTable *t, struct StrSetSetup *setup, size_t value_size) {
+    assert(t);
+    memset(t, 0, sizeof(*t));
+
+    t->hasher = strset_hasher_default(setup ? setup->hasher : NULL);
+    t->value_size = value_size;
+    // Выравнивание значения не больше наибольшей степени двойки, на которую
+    // делится его размер. Слоты лежат в памяти calloc(), она выровнена на
+    // max_align_t, поэтому смещение и размер слота кратны выравниванию.
+    size_t align = value_size & -value_size;
+    if (align < sizeof(uint64_t))
+        align = sizeof(uint64_t);
+    if (align > _Alignof(max_align_t))
+        align = _Alignof(max_align_t);
+    t->value_offset = align_up(sizeof(struct Slot), align);
+    t->slot_size = t->value_offset + align_up(value_size, align);
+
+    // заполнение не больше 3/4
+    size_t capacity = setup ? setup->capacity : 0, cap = CAPACITY_MIN;
+    while (cap * 3 / 4 < capacity)
+        cap *= 2;
+    slots_alloc(t, cap);
+}
+
+void strtable_shutdown(StrTable *t) {
+    assert(t);
+    free(t->slots);
+    strarena_free(&t->arena);
+    memset(t, 0, sizeof(*t));
+}
+
+void strtable_clear(StrTable *t) {
+    assert(t);
+    memset(t->slots, 0, t->cap * t->slot_size);
+    strarena_free(&t->arena);
+    t->count = 0;
+    t->dead = 0;
+}
+
+static void table_rehash(StrTable *t, size_t cap) {
+    uint8_t *old = t->slots;
+    size_t old_cap = t->cap;
+
+    // больше половины арены занято удаленными ключами - переложить
+    StrArena old_arena = t->arena;
+    bool compact = t->dead * 2 > t->arena.used;
+    if (compact) {
+        t->arena = (StrArena) {};
+        t->dead = 0;
+    }
+
+    slots_alloc(t, cap);
+    size_t mask = cap - 1;
+    for (size_t i = 0; i < old_cap; i++) {
+        struct Slot *from = (struct Slot*)(old + i * t->slot_size);
+        if (!from->hash)
+            continue;
+        size_t j = from->hash & mask;
+        while (slot_at(t, j)->hash)
+            j = (j + 1) & mask;
+        struct Slot *to = slot_at(t, j);
+        memcpy(to, from, t->slot_size);
+        if (compact)
+            to->key = strarena_strdup(&t->arena, from->key, from->len);
+    }
+
+    if (compact)
+        strarena_free(&old_arena);
+    free(old);
+}
+
+// Слот ключа или пустой слот, где он должен быть
+static inline size_t slot_find(
+    StrTable *t, uint64_t hash, const char *key, size_t len
+) {
+    size_t mask = t->cap - 1, i = hash & mask;
+    for (;; i = (i + 1) & mask) {
+        struct Slot *slot = slot_at(t, i);
+        if (!slot->hash)
+            return i;
+        if (slot->hash == hash && slot->len == len &&
+            !memcmp(slot->key, key, len))
+            return i;
+    }
+}
+
+void *strtable_get(StrTable *t, const char *key, size_t len) {
+    assert(t);
+    assert(key);
+    struct Slot *slot = slot_at(t, slot_find(t, key_hash(t, key, len), key, len));
+    return slot->hash ? slot_value(t, slot) : NULL;
+}
+
+const char *strtable_key(StrTable *t, void *value) {
+    assert(t);
+    assert(value);
+    return ((struct Slot*)((uint8_t*)value - t->value_offset))->key;
+}
+
+void *strtable_upsert(
+    StrTable *t, const char *key, size_t len, bool *inserted
+) {
+    assert(t);
+    assert(key);
+
+    uint64_t hash = key_hash(t, key, len);
+    struct Slot *slot = slot_at(t, slot_find(t, hash, key, len));
+    if (slot->hash) {
+        if (inserted)
+            *inserted = false;
+        return slot_value(t, slot);
+    }
+
+    // расширение только перед вставкой нового ключа. Таблица постоянного
+    // размера с частыми удалениями тоже пересобирается, чтобы арена не
+    // росла без предела.
+    bool grow = (t->count + 1) * 4 > t->cap * 3,
+         compact = t->dead > ARENA_CHUNK_SIZE && t->dead * 2 > t->arena.used;
+    if (grow || compact) {
+        table_rehash(t, grow ? t->cap * 2 : t->cap);
+        slot = slot_at(t, slot_find(t, hash, key, len));
+    }
+
+    slot->hash = hash;
+    slot->key = strarena_strdup(&t->arena, key, len);
+    slot->len = len;
+    memset(slot_value(t, slot), 0, t->value_size);
+    t->count++;
+    if (inserted)
+        *inserted = true;
+    return slot_value(t, slot);
+}
+
+// Сдвиг следующих слотов цепочки на место удаленного
+static void slot_erase(StrTable *t, size_t i) {
+    size_t mask = t->cap - 1;
+    struct Slot *hole = slot_at(t, i);
+    t->dead += hole->len + 1;
+
+    for (size_t j = (i + 1) & mask;; j = (j + 1) & mask) {
+        struct Slot *slot = slot_at(t, j);
+        if (!slot->hash)
+            break;
+        size_t home = slot->hash & mask;
+        // слот можно перенести в i, если его домашняя позиция не лежит
+        // циклически в (i, j]
+        bool movable = i <= j ? (home <= i || home > j) :
+                                (home <= i && home > j);
+        if (movable) {
+            memcpy(hole, slot, t->slot_size);
+            hole = slot;
+            i = j;
+        }
+    }
+
+    hole->hash = 0;
+    t->count--;
+}
+
+bool strtable_remove(StrTable *t, const char *key, size_t len) {
+    assert(t);
+    assert(key);
+
+    size_t i = slot_find(t, key_hash(t, key, len), key, len);
+    if (!slot_at(t, i)->hash)
+        return false;
+    slot_erase(t, i);
+    return true;
+}
+
+void strtable_each(
+    StrTable *t,
+    StrSetAction (*cb)(const char *key, void *value, void *udata),
+    void *udata
+) {
+    assert(t);
+    assert(cb);
+
+    // удаление сдвигает слоты, поэтому ключи удаляются после обхода.
+    // Ключи в арене не перемещаются без расширения таблицы.
+    const char **removed = NULL;
+    size_t *removed_len = NULL, removed_num = 0, removed_cap = 0;
+
+    for (size_t i = 0; i < t->cap; i++) {
+        struct Slot *slot = slot_at(t, i);
+        if (!slot->hash)
+            continue;
+
+        StrSetAction action = cb(slot->key, slot_value(t, slot), udata);
+        if (action == SSA_remove) {
+            if (removed_num == removed_cap) {
+                removed_cap = removed_cap ? removed_cap * 2 : 64;
+                removed = realloc(removed, sizeof(removed[0]) * removed_cap);
+                removed_len = realloc(
+                    removed_len, sizeof(removed_len[0]) * removed_cap
+                );
+                assert(removed && removed_len);
+            }
+            removed[removed_num] = slot->key;
+            removed_len[removed_num] = slot->len;
+            removed_num++;
+        } else if (action != SSA_next) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < removed_num; i++)
+        strtable_remove(t, removed[i], removed_len[i]);
+    free(removed);
+    free(removed_len);
+}
@@ -0,0 +1,63 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Общий движок для строковых таблиц со значениями (StrCount, StrMap):
+// открытая адресация с линейным пробированием, в слоте хэш, ключ и
+// значение фиксированного размера. Ключи копируются в арену. Удаление
+// сдвигает следующие слоты назад, надгробий нет.
+
+// {{{ Арена строк
+
+struct StrArenaChunk;
+
+typedef struct StrArena {
+    struct StrArenaChunk    *chunks;
+    // байт занято, вместе с уже ненужными строками
+    size_t                  used;
+} StrArena;
+
+// Копия len байт key с завершающим нулем
+const char *strarena_strdup(StrArena *arena, const char *key, size_t len);
+// Освобождает все строки, арена снова пустая
+void strarena_free(StrArena *arena);
+
+// }}}
+
+typedef struct StrTable {
+    HashFunction    hasher;
+    size_t          value_size, value_offset, slot_size;
+    uint8_t         *slots;
+    // степень двойки
+    size_t          cap, count;
+    StrArena        arena;
+    // байт арены под удаленными ключами
+    size_t          dead;
+} StrTable;
+
+void strtable_init(StrTable *t, struct StrSetSetup *setup, size_t value_size);
+void strtable_shutdown(StrTable *t);
+void strtable_clear(StrTable *t);
+
+// Указатели на значения действительны до следующего добавления или удаления
+void *strtable_get(StrTable *t, const char *key, size_t len);
+// Значение ключа за одну пробу, новый ключ получает нулевое значение
+void *strtable_upsert(
+    StrTable *t, const char *key, size_t len, bool *inserted
+);
+bool strtable_remove(StrTable *t, const char *key, size_t len);
+// Копия ключа в арене для значения из strtable_get() или strtable_upsert()
+const char *strtable_key(StrTable *t, void *value);
+// SSA_remove удаляет ключ после обхода, любое значение кроме SSA_next и
+// SSA_remove останавливает обход
+void strtable_each(
+    StrTable *t,
+    StrSetAction (*cb)(const char *key, void *value, void *udata),
+    void *udata
+);
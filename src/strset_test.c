@@ -3,10 +3,32 @@
 
 #include "koh_rand.h"
 #include "koh_strset.h"
+#include "strcount.h"
+#include "strfilter.h"
+#include "strhll.h"
+#include "strmap.h"
+#include "strminhash.h"
+#include "strset_atomic.h"
+#include "strset_bloom.h"
+#include "strset_ext.h"
+#include "strset_fc.h"
+#include "strset_frozen.h"
+#include "strset_hash.h"
+#include "strset_io.h"
+#include "strset_ops.h"
+#include "strset_parallel.h"
+#include "strset_sharded.h"
+#include "strset_sort.h"
+#include "strsym.h"
+#include "strtopk.h"
 #include "uthash.h"
 #include "munit.h"
 #include <unistd.h>
+#include <inttypes.h>
+#include <math.h>
 #include <memory.h>
+#include <pthread.h>
+#include <time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,6 +40,30 @@ struct Lines {
     int     num;
 };
 
+static double time_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Случайные строки для бенчмарков, повторы возможны
+static char **lines_random_new(int num, uint32_t seed) {
+    xorshift32_state rnd = { seed };
+    char **lines = calloc(num, sizeof(lines[0]));
+    for (int i = 0; i < num; ++i) {
+        char buf[64] = {};
+        sprintf(buf, "%u%u", xorshift32_rand(&rnd), xorshift32_rand(&rnd));
+        lines[i] = strdup(buf);
+    }
+    return lines;
+}
+
+static void lines_free(char **lines, int num) {
+    for (int i = 0; i < num; ++i)
+        free(lines[i]);
+    free(lines);
+}
+
 StrSetAction iter_set_remove(const char *key, void *udata) {
     return SSA_remove;
 }
@@ -37,6 +83,24 @@ StrSetAction iter_set_cmp(const char *key, void *udata) {
     return SSA_next;
 }
 
+StrSetAction iter_set_exist(const char *key, void *udata) {
+    StrSet *set = udata;
+    munit_assert(strset_exist(set, key));
+    return SSA_next;
+}
+
+StrSetAction iter_sharded_exist(const char *key, void *udata) {
+    StrSetSharded *set = udata;
+    munit_assert(strset_sharded_exist(set, key));
+    return SSA_next;
+}
+
+// udata - набор ключей на удаление
+StrSetAction iter_set_remove_listed(const char *key, void *udata) {
+    StrSet *listed = udata;
+    return strset_exist(listed, key) ? SSA_remove : SSA_next;
+}
+
 static MunitResult test_difference_internal(
     const MunitParameter params[], void* data, 
     char **lines1, size_t lines1_num,
@@ -122,7 +186,7 @@ static MunitResult test_compare_internal(
 }
 
 struct Line {
-    char            line[512];
+    char            *line;
     UT_hash_handle  hh;
 };
 
@@ -179,7 +243,7 @@ static MunitResult test_stress(
 
     printf("\n");
     FILE *T = fopen("1.txt", "w");
-    strset_print_f(set, T, "%s\n");
+    strset_write_f(set, T, "%s\n");
     fclose(T);
     printf("\n");
 
@@ -379,34 +443,45 @@ static MunitResult test_add_remove4(
     return MUNIT_OK;
 }
 
+// Копия src с дописанной строкой line во временном файле
+static char *data_with_line_new(const char *src, const char *line) {
+    char path[] = "/tmp/strset_compare_XXXXXX";
+    int fd = mkstemp(path);
+    munit_assert(fd >= 0);
+    FILE *in = fopen(src, "r"), *out = fdopen(fd, "w");
+    munit_assert(in && out);
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)))
+        munit_assert(fwrite(buf, 1, n, out) == n);
+    fprintf(out, "%s\n", line);
+    fclose(in);
+    fclose(out);
+    return strdup(path);
+}
+
 static MunitResult test_compare_with_uthash(
     const MunitParameter params[], void* data
 ) {
-    FILE *file_data = fopen("./strset_data1.txt", "r");
-    assert(file_data);
-
-    char line[512] = {};
-    size_t max_line_len = sizeof(line);
-    if (verbose) {
-        printf("test_compare_with_uthash: max_line_len %zu\n", max_line_len);
-    }
+    // длиннее прежнего буфера fgets() в 512 байт
+    const size_t long_len = 1500;
+    char *long_line = malloc(long_len + 1);
+    assert(long_line);
+    memset(long_line, 'z', long_len);
+    long_line[long_len] = 0;
+    char *path = data_with_line_new("./strset_data1.txt", long_line);
 
     StrSet *set = strset_new(NULL);
-    struct Line *lines = NULL;
-
-    while (fgets(line, max_line_len, file_data)) {
-        size_t line_len = strlen(line);
-        if (line[line_len - 1] == '\n') {
-            line[line_len - 1] = 0;
-        }
-        //printf("line '%s'\n", line);
-        strset_add(set, line);
-    }
+    munit_assert(strset_add_file(set, path, 0));
 
-    fseek(file_data, 0, SEEK_SET);
-    while (fgets(line, max_line_len, file_data)) {
-        size_t line_len = strlen(line);
-        if (line[line_len - 1] == '\n') {
+    struct Line *lines = NULL;
+    FILE *file_data = fopen(path, "r");
+    assert(file_data);
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t line_len;
+    while ((line_len = getline(&line, &cap, file_data)) >= 0) {
+        if (line_len && line[line_len - 1] == '\n') {
             line[line_len - 1] = 0;
         }
 
@@ -415,15 +490,14 @@ static MunitResult test_compare_with_uthash(
         if (!found) {
             struct Line *new = calloc(1, sizeof(*new));
             assert(new);
-            strncpy(new->line, line, max_line_len);
-            //strcpy(new->line, line);
-            HASH_ADD_STR(lines, line, new);
-        } else {
-            //printf("found\n");
+            new->line = strdup(line);
+            HASH_ADD_KEYPTR(hh, lines, new->line, strlen(new->line), new);
         }
     }
-
+    free(line);
     fclose(file_data);
+    unlink(path);
+    free(path);
 
     struct Line *item, *tmp;
 
@@ -448,15 +522,28 @@ static MunitResult test_compare_with_uthash(
         strset_compare(set_hh, set) ? "true" : "false",
         strset_compare(set, set_hh) ? "true" : "false"
     );
+    munit_assert(strset_compare(set_hh, set));
+    munit_assert(strset_count(set) == HASH_COUNT(lines));
+
+    // длинная строка - один ключ, без обрезков
+    munit_assert(strset_exist(set, long_line));
+    long_line[511] = 0;
+    munit_assert(!strset_exist(set, long_line));
+    free(long_line);
 
     HASH_ITER(hh, lines, item, tmp) {
         HASH_DEL(lines, item);
+        free(item->line);
         free(item);
     }
 
+    // отсортировано, что-бы файл можно было сравнивать другими средствами
+    size_t sorted_size = 0;
+    char *sorted = strset_to_sorted_buf(set, '\n', &sorted_size);
     T = fopen("T_set.txt", "w");
-    strset_print(set, T);
+    fwrite(sorted, 1, sorted_size, T);
     fclose(T);
+    free(sorted);
 
     /*
     struct EachCtx ctx = {
@@ -470,25 +557,27 @@ static MunitResult test_compare_with_uthash(
     return MUNIT_OK;
 }
 
-/*
-static MunitResult test_iter(
-    const MunitParameter params[], void* data
+static MunitResult test_iter_internal(
+    const MunitParameter params[], void* data,
+    struct StrSetExtSetup *setup
 ) {
-    struct StrSet *set = strset_new(NULL);
+    StrSetExt *set = strset_ext_new(setup);
 
     const char *lines[] = {
         "0", "1", "2", "3", NULL,
     };
 
     for (int i = 0; lines[i]; i++) {
-        strset_add(set, lines[i]);
+        strset_ext_add(set, lines[i]);
     }
 
-    for (struct StrSetIter i = strset_iter_new(set); strset_iter_valid(&i); 
-        strset_iter_next(&i)
+    int visited = 0;
+    for (StrSetExtIter i = strset_ext_iter_new(set); strset_ext_iter_valid(&i);
+        strset_ext_iter_next(&i)
     ) {
+        visited++;
         for (int j = 0; lines[j]; j++) {
-            if (!strcmp(lines[j], strset_iter_get(&i))) {
+            if (!strcmp(lines[j], strset_ext_iter_get(&i))) {
                 goto _next;
             }
         }
@@ -496,12 +585,69 @@ static MunitResult test_iter(
 _next:
         continue;
     }
+    munit_assert(visited == 4);
+
+    if (setup && setup->flags & SSX_dense) {
+        // порядок добавления, повторно добавленный ключ в конце
+        strset_ext_remove(set, "1");
+        strset_ext_remove(set, "2");
+        strset_ext_add(set, "1");
+        strset_ext_add(set, "4");
+
+        const char *order[] = { "0", "3", "1", "4", NULL, };
+        int j = 0;
+        for (StrSetExtIter i = strset_ext_iter_new(set);
+            strset_ext_iter_valid(&i); strset_ext_iter_next(&i)
+        ) {
+            munit_assert_ptr_not_null(order[j]);
+            munit_assert_string_equal(strset_ext_iter_get(&i), order[j++]);
+        }
+        munit_assert_ptr_null(order[j]);
+    }
 
-    strset_free(set);
+    strset_ext_free(set);
 
     return MUNIT_OK;
 }
-*/
+
+static MunitResult test_iter(
+    const MunitParameter params[], void* data
+) {
+    test_iter_internal(params, data, NULL);
+    test_iter_internal(params, data, &(struct StrSetExtSetup) {
+        .flags = SSX_dense,
+    });
+
+    const int lines_num = 20000;
+    char **lines = lines_random_new(lines_num, 43);
+    StrSetExt *set = strset_ext_new(&(struct StrSetExtSetup) {
+        .flags = SSX_dense,
+    });
+    StrSet *control = strset_new(NULL);
+
+    for (int i = 0; i < lines_num; i++) {
+        strset_ext_add(set, lines[i]);
+        strset_add(control, lines[i]);
+    }
+    for (int i = 0; i < lines_num; i += 2) {
+        strset_ext_remove(set, lines[i]);
+        strset_remove(control, lines[i]);
+    }
+
+    int visited = 0;
+    for (StrSetExtIter i = strset_ext_iter_new(set); strset_ext_iter_valid(&i);
+        strset_ext_iter_next(&i)
+    ) {
+        munit_assert(strset_exist(control, strset_ext_iter_get(&i)));
+        visited++;
+    }
+    munit_assert(visited == strset_count(control));
+
+    strset_free(control);
+    strset_ext_free(set);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
 
 static MunitResult test_compare(
     const MunitParameter params[], void* data
@@ -745,91 +891,2891 @@ static MunitResult test_new_add_exist_free(
     return MUNIT_OK;
 }
 
-static MunitTest test_suite_tests[] = {
-  {
-    (char*) "/new_add_exist_free",
-    test_new_add_exist_free,
-    NULL,
-    NULL,
-    MUNIT_TEST_OPTION_NONE,
-    NULL
-  },
-  {
-    (char*) "/massive_add_get",
-    test_massive_add_get,
-    NULL,
-    NULL,
-    MUNIT_TEST_OPTION_NONE,
-    NULL
-  },
-  {
-    (char*) "/compare",
-    test_compare,
-    NULL,
-    NULL,
-    MUNIT_TEST_OPTION_NONE,
-    NULL
-  },
+static StrSetAction iter_sharded_stop(const char *key, void *udata) {
+    int *num = udata;
+    (*num)++;
+    return SSA_break;
+}
 
-  {
-    (char*) "/difference",
-    test_difference,
-    NULL,
-    NULL,
-    MUNIT_TEST_OPTION_NONE,
-    NULL
-  },
+static MunitResult test_sharded_internal(
+    const MunitParameter params[], void* data,
+    struct StrSetShardedSetup *setup
+) {
+    StrSetSharded *set = strset_sharded_new(setup);
+    munit_assert_ptr_not_null(set);
 
-  {
-    (char*) "/compare_with_uthash",
-    test_compare_with_uthash,
-    NULL,
-    NULL,
-    MUNIT_TEST_OPTION_NONE,
-    NULL
-  },
+    const int lines_num = 5000;
+    char **lines = lines_random_new(lines_num, 7);
+    StrSet *control = strset_new(NULL);
 
-  /*
-    {
-      (char*) "/add_remove4",
-      test_add_remove4,
-      NULL,
-      NULL,
-      MUNIT_TEST_OPTION_NONE,
-      NULL
-    },
-*/
+    for (int i = 0; i < lines_num; ++i) {
+        bool added = strset_sharded_add(set, lines[i]);
+        munit_assert(added == !strset_exist(control, lines[i]));
+        strset_add(control, lines[i]);
+    }
+    munit_assert(strset_sharded_count(set) == strset_count(control));
 
-    {
-      (char*) "/add_remove2",
-      test_add_remove2,
-      NULL,
-      NULL,
-      MUNIT_TEST_OPTION_NONE,
-      NULL
-    },
+    for (int i = 0; i < lines_num; ++i) {
+        munit_assert(strset_sharded_exist(set, lines[i]));
+    }
+    munit_assert(!strset_sharded_exist(set, "not a number"));
 
-/*
-  {
-    (char*) "/stress",
-    test_stress,
-    NULL,
-    NULL,
-    MUNIT_TEST_OPTION_NONE,
-    NULL
-  },
-*/
+    for (int i = 0; i < lines_num; i += 2) {
+        strset_sharded_remove(set, lines[i]);
+        strset_remove(control, lines[i]);
+    }
+    munit_assert(strset_sharded_count(set) == strset_count(control));
 
-  /*
-  {
-    (char*) "/iter",
-    test_iter,
+    for (int i = 0; i < lines_num; ++i) {
+        munit_assert(
+            strset_sharded_exist(set, lines[i]) ==
+            strset_exist(control, lines[i])
+        );
+    }
+
+    // остановка в первом шарде не доходит до следующих
+    int visited = 0;
+    strset_sharded_each(set, iter_sharded_stop, &visited);
+    munit_assert(visited == 1);
+
+    strset_sharded_each(set, iter_set_remove, NULL);
+    munit_assert(strset_sharded_count(set) == 0);
+
+    strset_free(control);
+    lines_free(lines, lines_num);
+    strset_sharded_free(set);
+    return MUNIT_OK;
+}
+
+static MunitResult test_sharded(
+    const MunitParameter params[], void* data
+) {
+    test_sharded_internal(params, data, NULL);
+
+    int shards_nums[] = { 1, 2, 64, 256, };
+    int shards_nums_num = sizeof(shards_nums) / sizeof(shards_nums[0]);
+
+    for (int i = 0; koh_hashers[i].f; i++) {
+        for (int j = 0; j < shards_nums_num; j++) {
+            if (verbose) {
+                printf(
+                    "test_sharded: using '%s' function, %d shards\n",
+                    koh_hashers[i].fname, shards_nums[j]
+                );
+            }
+            test_sharded_internal(params, data, &(struct StrSetShardedSetup) {
+                .set = {
+                    .capacity = 11,
+                    .hasher = koh_hashers[i].f,
+                },
+                .shards_num = shards_nums[j],
+            });
+        }
+    }
+
+    return MUNIT_OK;
+}
+
+struct ScalingCtx {
+    StrSetSharded   *sharded;
+    StrSetAtomic    *atomic;
+    StrSet          *set;
+    pthread_mutex_t *lock;
+    char            **lines;
+    int             from, to;
+};
+
+static void *scaling_sharded_worker(void *arg) {
+    struct ScalingCtx *ctx = arg;
+    for (int i = ctx->from; i < ctx->to; i++)
+        strset_sharded_add(ctx->sharded, ctx->lines[i]);
+    return NULL;
+}
+
+static void *scaling_atomic_worker(void *arg) {
+    struct ScalingCtx *ctx = arg;
+    for (int i = ctx->from; i < ctx->to; i++)
+        strset_atomic_add(ctx->atomic, ctx->lines[i]);
+    return NULL;
+}
+
+static void *scaling_mutex_worker(void *arg) {
+    struct ScalingCtx *ctx = arg;
+    for (int i = ctx->from; i < ctx->to; i++) {
+        pthread_mutex_lock(ctx->lock);
+        strset_add(ctx->set, ctx->lines[i]);
+        pthread_mutex_unlock(ctx->lock);
+    }
+    return NULL;
+}
+
+// Добавления в секунду в зависимости от числа потоков, StrSetSharded и
+// StrSetAtomic против StrSet под одним мьютексом
+static MunitResult test_sharded_scaling(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 200000;
+    char **lines = lines_random_new(lines_num, 11);
+    int threads_nums[] = { 1, 2, 4, 8, 16, 32, };
+    int threads_nums_num = sizeof(threads_nums) / sizeof(threads_nums[0]);
+
+    StrSet *control = strset_new(NULL);
+    for (int i = 0; i < lines_num; i++)
+        strset_add(control, lines[i]);
+
+    for (int j = 0; j < threads_nums_num; j++) {
+        int threads_num = threads_nums[j];
+        pthread_t threads[threads_num];
+        struct ScalingCtx ctxs[threads_num];
+        pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+        StrSetSharded *sharded = strset_sharded_new(NULL);
+        StrSetAtomic *atomic = strset_atomic_new(NULL);
+        StrSet *set = strset_new(NULL);
+
+        for (int k = 0; k < threads_num; k++) {
+            ctxs[k] = (struct ScalingCtx) {
+                .sharded = sharded,
+                .atomic = atomic,
+                .set = set,
+                .lock = &lock,
+                .lines = lines,
+                .from = (int64_t)lines_num * k / threads_num,
+                .to = (int64_t)lines_num * (k + 1) / threads_num,
+            };
+        }
+
+        double start = time_now();
+        for (int k = 0; k < threads_num; k++)
+            pthread_create(&threads[k], NULL, scaling_sharded_worker, &ctxs[k]);
+        for (int k = 0; k < threads_num; k++)
+            pthread_join(threads[k], NULL);
+        double sharded_time = time_now() - start;
+
+        start = time_now();
+        for (int k = 0; k < threads_num; k++)
+            pthread_create(&threads[k], NULL, scaling_atomic_worker, &ctxs[k]);
+        for (int k = 0; k < threads_num; k++)
+            pthread_join(threads[k], NULL);
+        double atomic_time = time_now() - start;
+
+        start = time_now();
+        for (int k = 0; k < threads_num; k++)
+            pthread_create(&threads[k], NULL, scaling_mutex_worker, &ctxs[k]);
+        for (int k = 0; k < threads_num; k++)
+            pthread_join(threads[k], NULL);
+        double mutex_time = time_now() - start;
+
+        if (verbose) {
+            printf(
+                "test_sharded_scaling: threads %2d, sharded %.0f adds/s, "
+                "atomic %.0f adds/s, mutex %.0f adds/s\n",
+                threads_num, lines_num / sharded_time,
+                lines_num / atomic_time, lines_num / mutex_time
+            );
+        }
+
+        munit_assert(strset_sharded_count(sharded) == strset_count(control));
+        munit_assert(strset_atomic_count(atomic) == strset_count(control));
+        munit_assert(strset_count(set) == strset_count(control));
+
+        strset_sharded_free(sharded);
+        strset_atomic_free(atomic);
+        strset_free(set);
+    }
+
+    strset_free(control);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+struct AtomicCtx {
+    StrSetAtomic    *set;
+    char            **lines;
+    int             lines_num, added;
+    bool            reverse;
+};
+
+// Все потоки добавляют одни и те же строки с разных концов
+static void *atomic_worker(void *arg) {
+    struct AtomicCtx *ctx = arg;
+    for (int i = 0; i < ctx->lines_num; i++) {
+        int j = ctx->reverse ? ctx->lines_num - 1 - i : i;
+        if (strset_atomic_add(ctx->set, ctx->lines[j]))
+            ctx->added++;
+        munit_assert(strset_atomic_exist(ctx->set, ctx->lines[j]));
+    }
+    return NULL;
+}
+
+static MunitResult test_atomic_internal(
+    const MunitParameter params[], void* data,
+    struct StrSetSetup *setup
+) {
+    const int lines_num = 20000, threads_num = 8;
+    char **lines = lines_random_new(lines_num, 13);
+
+    StrSet *control = strset_new(NULL);
+    for (int i = 0; i < lines_num; i++)
+        strset_add(control, lines[i]);
+
+    StrSetAtomic *set = strset_atomic_new(setup);
+    munit_assert_ptr_not_null(set);
+
+    pthread_t threads[threads_num];
+    struct AtomicCtx ctxs[threads_num];
+    for (int k = 0; k < threads_num; k++) {
+        ctxs[k] = (struct AtomicCtx) {
+            .set = set,
+            .lines = lines,
+            .lines_num = lines_num,
+            .reverse = k & 1,
+        };
+        pthread_create(&threads[k], NULL, atomic_worker, &ctxs[k]);
+    }
+
+    int added = 0;
+    for (int k = 0; k < threads_num; k++) {
+        pthread_join(threads[k], NULL);
+        added += ctxs[k].added;
+    }
+
+    // каждая строка добавлена ровно одним потоком
+    munit_assert(added == strset_count(control));
+    munit_assert(strset_atomic_count(set) == strset_count(control));
+
+    for (int i = 0; i < lines_num; i++)
+        munit_assert(strset_atomic_exist(set, lines[i]));
+    munit_assert(!strset_atomic_exist(set, "not a number"));
+
+    strset_atomic_each(set, iter_set_exist, control);
+
+    strset_atomic_free(set);
+    strset_free(control);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_atomic(
+    const MunitParameter params[], void* data
+) {
+    test_atomic_internal(params, data, NULL);
+
+    for (int i = 0; koh_hashers[i].f; i++) {
+        if (verbose) {
+            printf("test_atomic: using '%s' function\n", koh_hashers[i].fname);
+        }
+        test_atomic_internal(params, data, &(struct StrSetSetup) {
+            .capacity = 11,
+            .hasher = koh_hashers[i].f,
+        });
+    }
+
+    return MUNIT_OK;
+}
+
+struct FCCtx {
+    StrSetFC        *fc;
+    StrSet          *set;
+    pthread_mutex_t *lock;
+    char            **lines;
+    int             from, to, added;
+};
+
+static void *fc_worker(void *arg) {
+    struct FCCtx *ctx = arg;
+    int slot = strset_fc_register(ctx->fc);
+    for (int i = ctx->from; i < ctx->to; i++) {
+        if (strset_fc_add(ctx->fc, slot, ctx->lines[i]))
+            ctx->added++;
+        munit_assert(strset_fc_exist(ctx->fc, slot, ctx->lines[i]));
+    }
+    return NULL;
+}
+
+static void *fc_mutex_worker(void *arg) {
+    struct FCCtx *ctx = arg;
+    for (int i = ctx->from; i < ctx->to; i++) {
+        pthread_mutex_lock(ctx->lock);
+        strset_add(ctx->set, ctx->lines[i]);
+        pthread_mutex_unlock(ctx->lock);
+
+        pthread_mutex_lock(ctx->lock);
+        munit_assert(strset_exist(ctx->set, ctx->lines[i]));
+        pthread_mutex_unlock(ctx->lock);
+    }
+    return NULL;
+}
+
+// StrSetFC против StrSet под одним мьютексом, add + exist на каждую строку
+static MunitResult test_fc(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 50000;
+    char **lines = lines_random_new(lines_num, 17);
+    int threads_nums[] = { 2, 4, 8, 16, 32, 64, };
+    int threads_nums_num = sizeof(threads_nums) / sizeof(threads_nums[0]);
+
+    StrSet *control = strset_new(NULL);
+    for (int i = 0; i < lines_num; i++)
+        strset_add(control, lines[i]);
+
+    for (int j = 0; j < threads_nums_num; j++) {
+        int threads_num = threads_nums[j];
+        pthread_t threads[threads_num];
+        struct FCCtx ctxs[threads_num];
+        pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+        StrSetFC *fc = strset_fc_new(NULL, threads_num);
+        StrSet *set = strset_new(NULL);
+
+        for (int k = 0; k < threads_num; k++) {
+            ctxs[k] = (struct FCCtx) {
+                .fc = fc,
+                .set = set,
+                .lock = &lock,
+                .lines = lines,
+                .from = (int64_t)lines_num * k / threads_num,
+                .to = (int64_t)lines_num * (k + 1) / threads_num,
+            };
+        }
+
+        double start = time_now();
+        for (int k = 0; k < threads_num; k++)
+            pthread_create(&threads[k], NULL, fc_worker, &ctxs[k]);
+        int added = 0;
+        for (int k = 0; k < threads_num; k++) {
+            pthread_join(threads[k], NULL);
+            added += ctxs[k].added;
+        }
+        double fc_time = time_now() - start;
+
+        start = time_now();
+        for (int k = 0; k < threads_num; k++)
+            pthread_create(&threads[k], NULL, fc_mutex_worker, &ctxs[k]);
+        for (int k = 0; k < threads_num; k++)
+            pthread_join(threads[k], NULL);
+        double mutex_time = time_now() - start;
+
+        if (verbose) {
+            printf(
+                "test_fc: threads %2d, flat combining %.0f ops/s, "
+                "mutex %.0f ops/s\n",
+                threads_num,
+                2. * lines_num / fc_time, 2. * lines_num / mutex_time
+            );
+        }
+
+        munit_assert(added == strset_count(control));
+        munit_assert(strset_fc_count(fc) == strset_count(control));
+        munit_assert(strset_compare(strset_fc_set(fc), control));
+
+        strset_fc_free(fc);
+        strset_free(set);
+    }
+
+    strset_free(control);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_build_parallel_internal(
+    const MunitParameter params[], void* data,
+    struct StrSetSetup *setup
+) {
+    const int lines_num = 100000;
+    char **lines = lines_random_new(lines_num, 19);
+    // повторы, как в логах
+    for (int i = lines_num / 2; i < lines_num; i++) {
+        free(lines[i]);
+        lines[i] = strdup(lines[i % 1000]);
+    }
+
+    double start = time_now();
+    StrSet *control = strset_new(setup);
+    for (int i = 0; i < lines_num; i++)
+        strset_add(control, lines[i]);
+    double serial_time = time_now() - start;
+
+    int threads_nums[] = { 1, 2, 4, 0, };
+    int threads_nums_num = sizeof(threads_nums) / sizeof(threads_nums[0]);
+
+    for (int j = 0; j < threads_nums_num; j++) {
+        start = time_now();
+        StrSet *set = strset_build_parallel(
+            lines, lines_num, setup, threads_nums[j]
+        );
+        double parallel_time = time_now() - start;
+
+        StrSetSharded *sharded = strset_sharded_build_parallel(
+            lines, lines_num, NULL, threads_nums[j]
+        );
+
+        if (verbose) {
+            printf(
+                "test_build_parallel: threads %d, serial %.4fs, "
+                "parallel %.4fs\n",
+                threads_nums[j], serial_time, parallel_time
+            );
+        }
+
+        munit_assert(strset_compare(set, control));
+        munit_assert(strset_sharded_count(sharded) == strset_count(control));
+        for (int i = 0; i < lines_num; i++)
+            munit_assert(strset_sharded_exist(sharded, lines[i]));
+
+        strset_sharded_free(sharded);
+        strset_free(set);
+    }
+
+    StrSet *empty = strset_build_parallel(NULL, 0, setup, 0);
+    munit_assert(strset_count(empty) == 0);
+    strset_free(empty);
+
+    strset_free(control);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_build_parallel(
+    const MunitParameter params[], void* data
+) {
+    test_build_parallel_internal(params, data, NULL);
+
+    for (int i = 0; koh_hashers[i].f; i++) {
+        if (verbose) {
+            printf(
+                "test_build_parallel: using '%s' function\n",
+                koh_hashers[i].fname
+            );
+        }
+        test_build_parallel_internal(params, data, &(struct StrSetSetup) {
+            .capacity = 11,
+            .hasher = koh_hashers[i].f,
+        });
+    }
+
+    return MUNIT_OK;
+}
+
+static StrSet *set_from_lines(
+    struct StrSetSetup *setup, char **lines, size_t lines_num
+) {
+    StrSet *set = strset_new(setup);
+    munit_assert_ptr_not_null(set);
+    for (size_t i = 0; i < lines_num; ++i)
+        strset_add(set, lines[i]);
+    return set;
+}
+
+static MunitResult test_ops_internal(
+    const MunitParameter params[], void* data,
+    struct StrSetSetup *setup,
+    char **lines1, size_t lines1_num,
+    char **lines2, size_t lines2_num,
+    char **union_be, size_t union_be_num,
+    char **inter_be, size_t inter_be_num,
+    char **sym_be, size_t sym_be_num
+) {
+    StrSet *set1 = set_from_lines(setup, lines1, lines1_num);
+    StrSet *set2 = set_from_lines(setup, lines2, lines2_num);
+
+    StrSet *res = strset_union(set1, set2, setup);
+    munit_assert(strset_compare_strs(res, union_be, union_be_num));
+    strset_free(res);
+
+    res = strset_intersection(set1, set2, setup);
+    munit_assert(strset_compare_strs(res, inter_be, inter_be_num));
+    strset_free(res);
+
+    res = strset_symmetric_difference(set1, set2, setup);
+    munit_assert(strset_compare_strs(res, sym_be, sym_be_num));
+    strset_free(res);
+
+    StrSet *difference = strset_difference(set1, set2);
+    res = set_from_lines(setup, lines2, lines2_num);
+    strset_difference_into(res, set1, set2);
+    munit_assert(strset_compare(res, difference));
+
+    strset_free(res);
+    res = set_from_lines(setup, lines1, lines1_num);
+    strset_difference_into(res, res, set2);
+    munit_assert(strset_compare(res, difference));
+
+    // dst совпадает с b
+    strset_free(res);
+    res = set_from_lines(setup, lines2, lines2_num);
+    strset_difference_into(res, set1, res);
+    munit_assert(strset_compare(res, difference));
+
+    // a \ a
+    strset_free(res);
+    res = set_from_lines(setup, lines1, lines1_num);
+    strset_difference_into(res, res, res);
+    munit_assert(strset_count(res) == 0);
+    strset_difference_into(res, set1, set1);
+    munit_assert(strset_count(res) == 0);
+    munit_assert(strset_count(set1) == lines1_num);
+
+    strset_free(res);
+    res = set_from_lines(setup, lines1, lines1_num);
+    strset_intersect_inplace(res, set2);
+    munit_assert(strset_compare_strs(res, inter_be, inter_be_num));
+
+    strset_union_inplace(res, set1);
+    munit_assert(strset_compare(res, set1));
+    strset_union_inplace(res, set2);
+    munit_assert(strset_compare_strs(res, union_be, union_be_num));
+
+    strset_free(res);
+    strset_free(difference);
+    strset_free(set1);
+    strset_free(set2);
+    return MUNIT_OK;
+}
+
+static MunitResult test_ops_internal_setup(
+    const MunitParameter params[], void* data,
+    struct StrSetSetup *setup
+) {
+    {
+        char *lines1[] = { "1", "2", "3", "4", };
+        char *lines2[] = { "3", "4", "5", };
+        char *union_be[] = { "1", "2", "3", "4", "5", };
+        char *inter_be[] = { "3", "4", };
+        char *sym_be[] = { "1", "2", "5", };
+
+        test_ops_internal(
+            params, data, setup,
+            lines1, sizeof(lines1) / sizeof(lines1[0]),
+            lines2, sizeof(lines2) / sizeof(lines2[0]),
+            union_be, sizeof(union_be) / sizeof(union_be[0]),
+            inter_be, sizeof(inter_be) / sizeof(inter_be[0]),
+            sym_be, sizeof(sym_be) / sizeof(sym_be[0])
+        );
+    }
+
+    {
+        char *lines1[] = { "1", };
+        char *lines2[] = { "2", "3", };
+        char *union_be[] = { "1", "2", "3", };
+        char *inter_be[] = { };
+        char *sym_be[] = { "1", "2", "3", };
+
+        test_ops_internal(
+            params, data, setup,
+            lines1, sizeof(lines1) / sizeof(lines1[0]),
+            lines2, sizeof(lines2) / sizeof(lines2[0]),
+            union_be, sizeof(union_be) / sizeof(union_be[0]),
+            inter_be, sizeof(inter_be) / sizeof(inter_be[0]),
+            sym_be, sizeof(sym_be) / sizeof(sym_be[0])
+        );
+    }
+
+    {
+        char *lines1[] = { "1", "2", };
+        char *lines2[] = { "2", "1", };
+        char *union_be[] = { "1", "2", };
+        char *inter_be[] = { "1", "2", };
+        char *sym_be[] = { };
+
+        test_ops_internal(
+            params, data, setup,
+            lines1, sizeof(lines1) / sizeof(lines1[0]),
+            lines2, sizeof(lines2) / sizeof(lines2[0]),
+            union_be, sizeof(union_be) / sizeof(union_be[0]),
+            inter_be, sizeof(inter_be) / sizeof(inter_be[0]),
+            sym_be, sizeof(sym_be) / sizeof(sym_be[0])
+        );
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_ops(
+    const MunitParameter params[], void* data
+) {
+    test_ops_internal_setup(params, data, NULL);
+
+    for (int i = 0; koh_hashers[i].f; i++) {
+        if (verbose) {
+            printf("test_ops: using '%s' function\n", koh_hashers[i].fname);
+        }
+        test_ops_internal_setup(params, data, &(struct StrSetSetup) {
+            .capacity = 11,
+            .hasher = koh_hashers[i].f,
+        });
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_ops_many(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 4000, sets_num = 12;
+    char **lines = lines_random_new(lines_num, 31);
+    StrSet *sets[sets_num];
+
+    // окна строк со сдвигом, у всех общая середина
+    for (int i = 0; i < sets_num; i++) {
+        int from = i * 100, to = lines_num - (sets_num - i) * 100;
+        sets[i] = set_from_lines(NULL, lines + from, to - from);
+    }
+
+    StrSet *union_be = strset_new(NULL), *inter_be = strset_new(NULL);
+    strset_union_inplace(union_be, sets[0]);
+    strset_union_inplace(inter_be, sets[0]);
+    for (int i = 1; i < sets_num; i++) {
+        strset_union_inplace(union_be, sets[i]);
+        strset_intersect_inplace(inter_be, sets[i]);
+    }
+
+    StrSet *res = strset_union_many(sets, sets_num, NULL);
+    munit_assert(strset_compare(res, union_be));
+    strset_free(res);
+
+    res = strset_intersection_many(sets, sets_num, NULL);
+    munit_assert(strset_compare(res, inter_be));
+    munit_assert(strset_count(res) == lines_num - 2 * sets_num * 100 + 100);
+    strset_free(res);
+
+    res = strset_intersection_many(sets, 1, NULL);
+    munit_assert(strset_compare(res, sets[0]));
+    strset_free(res);
+
+    res = strset_union_many(NULL, 0, NULL);
+    munit_assert(strset_count(res) == 0);
+    strset_free(res);
+
+    StrSet *empty = strset_new(NULL);
+    StrSet *with_empty[] = { sets[0], empty, sets[1], };
+    res = strset_intersection_many(with_empty, 3, NULL);
+    munit_assert(strset_count(res) == 0);
+    strset_free(res);
+    strset_free(empty);
+
+    for (int i = 0; i < sets_num; i++)
+        strset_free(sets[i]);
+    strset_free(union_be);
+    strset_free(inter_be);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_ops_parallel(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 100000;
+    char **lines = lines_random_new(lines_num, 23);
+
+    // пересекаются по половине
+    StrSet *a = set_from_lines(NULL, lines, lines_num * 2 / 3);
+    StrSet *b = set_from_lines(
+        NULL, lines + lines_num / 3, lines_num - lines_num / 3
+    );
+    StrSetSharded *sa = strset_sharded_build_parallel(
+        lines, lines_num * 2 / 3, NULL, 0
+    );
+    StrSetSharded *sb = strset_sharded_build_parallel(
+        lines + lines_num / 3, lines_num - lines_num / 3, NULL, 0
+    );
+
+    double start = time_now();
+    StrSet *difference = strset_difference(a, b);
+    double serial_time = time_now() - start;
+    StrSet *intersection = strset_intersection(a, b, NULL);
+    StrSet *union_ = strset_union(a, b, NULL);
+
+    int threads_nums[] = { 1, 2, 4, 8, 0, };
+    int threads_nums_num = sizeof(threads_nums) / sizeof(threads_nums[0]);
+
+    // результат с другим hasher, шарды считаются им же
+    struct StrSetShardedSetup res_setup = {
+        .set.hasher = koh_hashers[0].f,
+        .shards_num = 16,
+    };
+
+    for (int j = 0; j < threads_nums_num; j++) {
+        start = time_now();
+        StrSetSharded *res = strset_difference_parallel(
+            a, b, NULL, threads_nums[j]
+        );
+        double parallel_time = time_now() - start;
+        munit_assert(strset_sharded_count(res) == strset_count(difference));
+        strset_each(difference, iter_sharded_exist, res);
+        strset_sharded_free(res);
+
+        start = time_now();
+        StrSetSharded *sres = strset_sharded_difference(sa, sb, threads_nums[j]);
+        double sharded_time = time_now() - start;
+        munit_assert(strset_sharded_count(sres) == strset_count(difference));
+        strset_each(difference, iter_sharded_exist, sres);
+        strset_sharded_free(sres);
+
+        if (verbose) {
+            printf(
+                "test_ops_parallel: threads %d, strset_difference %.4fs, "
+                "parallel %.4fs, sharded %.4fs\n",
+                threads_nums[j], serial_time, parallel_time, sharded_time
+            );
+        }
+
+        res = strset_intersection_parallel(a, b, &res_setup, threads_nums[j]);
+        munit_assert(strset_sharded_hasher(res) == res_setup.set.hasher);
+        munit_assert(strset_sharded_count(res) == strset_count(intersection));
+        strset_each(intersection, iter_sharded_exist, res);
+        strset_sharded_free(res);
+
+        res = strset_union_parallel(a, b, &res_setup, threads_nums[j]);
+        munit_assert(strset_sharded_count(res) == strset_count(union_));
+        strset_each(union_, iter_sharded_exist, res);
+        strset_sharded_free(res);
+
+        sres = strset_sharded_intersection(sa, sb, threads_nums[j]);
+        munit_assert(strset_sharded_count(sres) == strset_count(intersection));
+        strset_each(intersection, iter_sharded_exist, sres);
+        strset_sharded_free(sres);
+
+        sres = strset_sharded_union(sa, sb, threads_nums[j]);
+        munit_assert(strset_sharded_count(sres) == strset_count(union_));
+        strset_each(union_, iter_sharded_exist, sres);
+        strset_sharded_free(sres);
+    }
+
+    strset_free(difference);
+    strset_free(intersection);
+    strset_free(union_);
+    strset_sharded_free(sa);
+    strset_sharded_free(sb);
+    strset_free(a);
+    strset_free(b);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static StrSetAction iter_view_collect(const char *key, void *udata) {
+    StrSet *set = udata;
+    // ключ не должен встречаться дважды
+    munit_assert(!strset_exist(set, key));
+    strset_add(set, key);
+    return SSA_next;
+}
+
+static StrSetAction iter_view_stop(const char *key, void *udata) {
+    int *num = udata;
+    (*num)++;
+    return SSA_break;
+}
+
+static StrSetAction iter_view_remove(const char *key, void *udata) {
+    int *num = udata;
+    (*num)++;
+    return SSA_remove;
+}
+
+static MunitResult test_views(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 3000;
+    char **lines = lines_random_new(lines_num, 29);
+
+    StrSet *a = set_from_lines(NULL, lines, lines_num * 2 / 3);
+    StrSet *b = set_from_lines(
+        NULL, lines + lines_num / 3, lines_num - lines_num / 3
+    );
+
+    struct {
+        StrSetView  view;
+        StrSet      *be;
+    } cases[] = {
+        { strset_view_difference(a, b), strset_difference(a, b), },
+        { strset_view_difference(b, a), strset_difference(b, a), },
+        { strset_view_intersection(a, b), strset_intersection(a, b, NULL), },
+        { strset_view_union(a, b), strset_union(a, b, NULL), },
+        {
+            strset_view_symmetric_difference(a, b),
+            strset_symmetric_difference(a, b, NULL),
+        },
+    };
+    int cases_num = sizeof(cases) / sizeof(cases[0]);
+
+    for (int i = 0; i < cases_num; i++) {
+        StrSetView *view = &cases[i].view;
+        StrSet *be = cases[i].be;
+
+        munit_assert(strset_view_count(view) == strset_count(be));
+
+        StrSet *collected = strset_new(NULL);
+        strset_view_each(view, iter_view_collect, collected);
+        munit_assert(strset_compare(collected, be));
+        strset_free(collected);
+
+        for (int j = 0; j < lines_num; j++) {
+            munit_assert(
+                strset_view_exist(view, lines[j]) ==
+                strset_exist(be, lines[j])
+            );
+        }
+
+        int visited = 0;
+        strset_view_each(view, iter_view_stop, &visited);
+        munit_assert(visited == (strset_count(be) ? 1 : 0));
+
+        // входные наборы не меняются, обход идет дальше
+        size_t a_num = strset_count(a), b_num = strset_count(b);
+        visited = 0;
+        strset_view_each(view, iter_view_remove, &visited);
+        munit_assert(visited == strset_count(be));
+        munit_assert(strset_count(a) == a_num && strset_count(b) == b_num);
+
+        strset_free(be);
+    }
+
+    munit_assert(strset_difference_count(a, b) == lines_num / 3);
+    munit_assert(strset_intersection_count(a, b) == lines_num / 3);
+
+    strset_free(a);
+    strset_free(b);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_ext_compare_internal(
+    const MunitParameter params[], void* data,
+    struct StrSetExtSetup *setup
+) {
+    const int lines_num = 20000;
+    char **lines = lines_random_new(lines_num, 37);
+
+    StrSetExt *a = strset_ext_new(setup), *b = strset_ext_new(setup);
+    munit_assert_ptr_not_null(a);
+    munit_assert_ptr_not_null(b);
+
+    // разный порядок добавления и удаления
+    for (int i = 0; i < lines_num; i++) {
+        strset_ext_add(a, lines[i]);
+        strset_ext_add(b, lines[lines_num - 1 - i]);
+    }
+    munit_assert(!strset_ext_add(a, lines[0]));
+    StrSet *listed = strset_new(NULL);
+    for (int i = 0; i < lines_num; i += 3) {
+        strset_ext_remove(a, lines[i]);
+        strset_add(listed, lines[i]);
+    }
+    strset_ext_each(b, iter_set_remove_listed, listed);
+    strset_free(listed);
+    strset_ext_remove(b, "not a number");
+
+    munit_assert(strset_ext_count(a) == strset_ext_count(b));
+    munit_assert(strset_ext_fingerprint(a) == strset_ext_fingerprint(b));
+    munit_assert(strset_ext_compare(a, b));
+
+    char **kept = calloc(lines_num, sizeof(kept[0]));
+    int kept_num = 0;
+    for (int i = 0; i < lines_num; i++)
+        if (i % 3)
+            kept[kept_num++] = lines[i];
+    munit_assert(strset_ext_compare_strs(a, kept, kept_num));
+    munit_assert(!strset_ext_compare_strs(a, kept, kept_num - 1));
+    kept[0] = lines[0];
+    munit_assert(!strset_ext_compare_strs(a, kept, kept_num));
+
+    // тот же размер, один ключ другой
+    strset_ext_remove(b, lines[1]);
+    strset_ext_add(b, lines[0]);
+    munit_assert(strset_ext_count(a) == strset_ext_count(b));
+
+    double start = time_now();
+    munit_assert(!strset_compare(strset_ext_set(a), strset_ext_set(b)));
+    double full_time = time_now() - start;
+
+    start = time_now();
+    munit_assert(!strset_ext_compare(a, b));
+    double fast_time = time_now() - start;
+
+    if (verbose) {
+        printf(
+            "test_ext_compare: strset_compare %.6fs, "
+            "strset_ext_compare %.6fs\n", full_time, fast_time
+        );
+    }
+
+    strset_ext_clear(a);
+    munit_assert(strset_ext_fingerprint(a) == 0);
+
+    free(kept);
+    strset_ext_free(a);
+    strset_ext_free(b);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_ext_compare(
+    const MunitParameter params[], void* data
+) {
+    test_ext_compare_internal(params, data, NULL);
+
+    for (int i = 0; koh_hashers[i].f; i++) {
+        if (verbose) {
+            printf(
+                "test_ext_compare: using '%s' function\n",
+                koh_hashers[i].fname
+            );
+        }
+        test_ext_compare_internal(params, data, &(struct StrSetExtSetup) {
+            .set = {
+                .capacity = 11,
+                .hasher = koh_hashers[i].f,
+            },
+        });
+    }
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_frozen_internal(
+    const MunitParameter params[], void* data,
+    struct StrSetSetup *setup
+) {
+    const int lines_num = 30000;
+    char **lines = lines_random_new(lines_num, 41);
+
+    StrSet *a = set_from_lines(setup, lines, lines_num * 2 / 3);
+    StrSet *b = set_from_lines(
+        setup, lines + lines_num / 3, lines_num - lines_num / 3
+    );
+    StrSet *a_copy = set_from_lines(setup, lines, lines_num * 2 / 3);
+
+    HashFunction hasher = setup ? setup->hasher : NULL;
+    StrSetFrozen *fa = strset_frozen_new(a, hasher),
+                 *fb = strset_frozen_new(b, hasher),
+                 *fa_copy = strset_frozen_new(a_copy, hasher);
+
+    munit_assert(strset_frozen_count(fa) == strset_count(a));
+    for (int i = 0; i < lines_num; i++)
+        munit_assert(
+            strset_frozen_exist(fa, lines[i]) == strset_exist(a, lines[i])
+        );
+    strset_frozen_each(fa, iter_set_exist, a);
+
+    double start = time_now();
+    StrSet *difference = strset_difference(a, b);
+    double probe_time = time_now() - start;
+
+    start = time_now();
+    StrSet *res = strset_frozen_difference(fa, fb);
+    double merge_time = time_now() - start;
+
+    if (verbose) {
+        printf(
+            "test_frozen: strset_difference %.4fs, merge %.4fs\n",
+            probe_time, merge_time
+        );
+    }
+
+    munit_assert(strset_compare(res, difference));
+    munit_assert(
+        strset_frozen_difference_count(fa, fb) == strset_count(difference)
+    );
+    strset_free(res);
+
+    StrSet *intersection = strset_intersection(a, b, NULL);
+    res = strset_frozen_intersection(fa, fb);
+    munit_assert(strset_compare(res, intersection));
+    strset_free(res);
+
+    munit_assert(strset_frozen_compare(fa, fa_copy));
+    munit_assert(!strset_frozen_compare(fa, fb));
+
+    strset_remove(a_copy, lines[0]);
+    strset_add(a_copy, lines[lines_num - 1]);
+    StrSetFrozen *fa_other = strset_frozen_new(a_copy, hasher);
+    munit_assert(!strset_frozen_compare(fa, fa_other));
+
+    strset_frozen_free(fa);
+    strset_frozen_free(fb);
+    strset_frozen_free(fa_copy);
+    strset_frozen_free(fa_other);
+    strset_free(difference);
+    strset_free(intersection);
+    strset_free(a);
+    strset_free(b);
+    strset_free(a_copy);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+// Слияние снимков против операций над наборами
+static void frozen_ops_check(StrSet *a, StrSet *b) {
+    StrSetFrozen *fa = strset_frozen_new(a, NULL),
+                 *fb = strset_frozen_new(b, NULL);
+
+    StrSet *expected = strset_difference(a, b),
+           *res = strset_frozen_difference(fa, fb);
+    munit_assert(strset_compare(res, expected));
+    strset_free(res);
+    strset_free(expected);
+
+    expected = strset_intersection(a, b, NULL);
+    res = strset_frozen_intersection(fa, fb);
+    munit_assert(strset_compare(res, expected));
+    strset_free(res);
+    strset_free(expected);
+
+    strset_frozen_free(fa);
+    strset_frozen_free(fb);
+}
+
+// Длинные прыжки по b: редкий a против плотного b, и b короче пачки
+static void test_frozen_skip(void) {
+    const int lines_num = 30000, step = 600;
+    char **lines = lines_random_new(lines_num, 43);
+
+    StrSet *sparse = strset_new(NULL);
+    for (int i = 0; i < lines_num; i += step)
+        strset_add(sparse, lines[i]);
+    StrSet *dense = set_from_lines(NULL, lines, lines_num);
+    StrSet *tiny = set_from_lines(NULL, lines, 3);
+
+    frozen_ops_check(sparse, dense);
+    frozen_ops_check(dense, sparse);
+    frozen_ops_check(sparse, tiny);
+    frozen_ops_check(dense, tiny);
+
+    strset_free(sparse);
+    strset_free(dense);
+    strset_free(tiny);
+    lines_free(lines, lines_num);
+}
+
+static MunitResult test_frozen(
+    const MunitParameter params[], void* data
+) {
+    // сначала путь AVX2, если он есть, затем скалярный
+    bool modes[] = { true, false };
+    for (int m = 0; m < 2; m++) {
+        bool avx2 = strset_frozen_use_avx2(modes[m]);
+        if (verbose) {
+            printf("test_frozen: avx2 %s\n", avx2 ? "on" : "off");
+        }
+        if (modes[m] && !avx2) {
+            printf("test_frozen: avx2 is not supported, skipped\n");
+            continue;
+        }
+
+        test_frozen_internal(params, data, NULL);
+
+        for (int i = 0; koh_hashers[i].f; i++) {
+            if (verbose) {
+                printf(
+                    "test_frozen: using '%s' function\n", koh_hashers[i].fname
+                );
+            }
+            test_frozen_internal(params, data, &(struct StrSetSetup) {
+                .capacity = 11,
+                .hasher = koh_hashers[i].f,
+            });
+        }
+
+        test_frozen_skip();
+    }
+    strset_frozen_use_avx2(true);
+
+    return MUNIT_OK;
+}
+
+struct EachParallelCtx {
+    StrSet  *control;
+    int     visited;
+};
+
+// Удаляет ключи, оканчивающиеся на 7
+static StrSetAction iter_each_parallel(const char *key, void *udata) {
+    struct EachParallelCtx *ctx = udata;
+    munit_assert(strset_exist(ctx->control, key));
+    ctx->visited++;
+    return key[strlen(key) - 1] == '7' ? SSA_remove : SSA_next;
+}
+
+static StrSetAction iter_remove_7(const char *key, void *udata) {
+    return key[strlen(key) - 1] == '7' ? SSA_remove : SSA_next;
+}
+
+static MunitResult test_each_parallel(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 50000;
+    char **lines = lines_random_new(lines_num, 47);
+    int threads_nums[] = { 1, 3, 8, 0, };
+    int threads_nums_num = sizeof(threads_nums) / sizeof(threads_nums[0]);
+
+    StrSet *control = set_from_lines(NULL, lines, lines_num);
+    StrSet *control_removed = set_from_lines(NULL, lines, lines_num);
+    strset_each(control_removed, iter_remove_7, NULL);
+
+    for (int j = 0; j < threads_nums_num; j++) {
+        int threads_num = threads_nums[j] ?
+            threads_nums[j] : strset_threads_num_default();
+        struct EachParallelCtx ctxs[threads_num];
+        void *udata[threads_num];
+        for (int k = 0; k < threads_num; k++) {
+            ctxs[k] = (struct EachParallelCtx) { .control = control, };
+            udata[k] = &ctxs[k];
+        }
+
+        StrSet *set = set_from_lines(NULL, lines, lines_num);
+        strset_each_parallel(set, threads_num, iter_each_parallel, udata);
+
+        int visited = 0;
+        for (int k = 0; k < threads_num; k++)
+            visited += ctxs[k].visited;
+        munit_assert(visited == strset_count(control));
+        munit_assert(strset_compare(set, control_removed));
+
+        strset_free(set);
+    }
+
+    strset_free(control);
+    strset_free(control_removed);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static int cmp_strs(const void *a, const void *b) {
+    return strcmp(*(const char**)a, *(const char**)b);
+}
+
+static MunitResult test_sorted(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 50000;
+    char **lines = lines_random_new(lines_num, 53);
+    // общие префиксы и строки-префиксы друг друга
+    for (int i = 0; i < lines_num; i += 4) {
+        char buf[128] = {};
+        snprintf(buf, sizeof(buf), "stage_add: name '%s'", lines[i]);
+        free(lines[i]);
+        lines[i] = strdup(buf);
+    }
+    for (int i = 1; i < lines_num; i += 8)
+        lines[i][strlen(lines[i]) / 2] = 0;
+
+    StrSet *set = set_from_lines(NULL, lines, lines_num);
+
+    size_t num = 0;
+    const char **sorted = strset_to_sorted_array(set, &num);
+    munit_assert(num == strset_count(set));
+
+    // оба способа на одном неупорядоченном массиве
+    const char **be = malloc(sizeof(be[0]) * num);
+    const char **mk = malloc(sizeof(mk[0]) * num);
+    StrSet *seen = strset_new(NULL);
+    num = 0;
+    for (int i = 0; i < lines_num; i++)
+        if (!strset_exist(seen, lines[i])) {
+            strset_add(seen, lines[i]);
+            be[num] = mk[num] = lines[i];
+            num++;
+        }
+    strset_free(seen);
+    munit_assert(num == strset_count(set));
+
+    double start = time_now();
+    qsort(be, num, sizeof(be[0]), cmp_strs);
+    double qsort_time = time_now() - start;
+
+    start = time_now();
+    strset_sort_strs(mk, num);
+    double mkqsort_time = time_now() - start;
+
+    if (verbose) {
+        printf(
+            "test_sorted: qsort %.4fs, strset_sort_strs %.4fs\n",
+            qsort_time, mkqsort_time
+        );
+    }
+
+    for (size_t i = 0; i < num; i++)
+        munit_assert_string_equal(mk[i], be[i]);
+    free(mk);
+
+    for (size_t i = 0; i < num; i++)
+        munit_assert_string_equal(sorted[i], be[i]);
+
+    size_t size = 0;
+    char *buf = strset_to_sorted_buf(set, '\n', &size);
+    munit_assert(strlen(buf) == size);
+    char *p = buf;
+    for (size_t i = 0; i < num; i++) {
+        size_t len = strlen(be[i]);
+        munit_assert(!strncmp(p, be[i], len) && p[len] == '\n');
+        p += len + 1;
+    }
+    free(buf);
+
+    free(be);
+    free(sorted);
+    strset_free(set);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static char *file_read_all(FILE *f, size_t *size) {
+    fflush(f);
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc(len + 1);
+    assert(buf);
+    size_t got = fread(buf, 1, len, f);
+    munit_assert(got == (size_t)len);
+    buf[len] = 0;
+    if (size)
+        *size = len;
+    return buf;
+}
+
+// Строки файла по возрастанию, буфер разрезается на месте
+static const char **file_lines_sorted(char *buf, size_t *num) {
+    size_t cap = 1;
+    for (char *p = buf; *p; p++)
+        cap += *p == '\n';
+    const char **strs = malloc(sizeof(strs[0]) * cap);
+    assert(strs);
+
+    size_t n = 0;
+    for (char *p = buf, *nl; *p; p = nl + 1) {
+        nl = strchr(p, '\n');
+        munit_assert_not_null(nl);
+        *nl = 0;
+        strs[n++] = p;
+    }
+    strset_sort_strs(strs, n);
+    *num = n;
+    return strs;
+}
+
+static void write_check(StrSet *set, const char *fmt) {
+    FILE *expected = tmpfile(), *written = tmpfile();
+    munit_assert_not_null(expected);
+    munit_assert_not_null(written);
+
+    double start = time_now();
+    strset_print_f(set, expected, fmt ? fmt : "%s\n");
+    fflush(expected);
+    double print_time = time_now() - start;
+
+    start = time_now();
+    munit_assert(strset_write_fd(set, fileno(written), fmt));
+    double write_time = time_now() - start;
+
+    if (verbose) {
+        printf(
+            "write_check: fmt '%s', strset_print_f %.4fs, "
+            "strset_write_fd %.4fs\n",
+            fmt ? fmt : "(null)", print_time, write_time
+        );
+    }
+
+    // порядок обхода не задан, сравниваются отсортированные строки
+    size_t expected_size = 0, written_size = 0;
+    char *expected_buf = file_read_all(expected, &expected_size),
+         *written_buf = file_read_all(written, &written_size);
+    munit_assert(expected_size == written_size);
+
+    size_t expected_num = 0, written_num = 0;
+    const char **expected_lines = file_lines_sorted(
+        expected_buf, &expected_num
+    );
+    const char **written_lines = file_lines_sorted(written_buf, &written_num);
+    munit_assert(expected_num == written_num);
+    for (size_t i = 0; i < expected_num; i++)
+        munit_assert_string_equal(expected_lines[i], written_lines[i]);
+
+    free(expected_lines);
+    free(written_lines);
+    free(expected_buf);
+    free(written_buf);
+    fclose(expected);
+    fclose(written);
+}
+
+static MunitResult test_write(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 300000;
+    char **lines = lines_random_new(lines_num, 59);
+    StrSet *set = set_from_lines(NULL, lines, lines_num);
+
+    write_check(set, "%s\n");
+    write_check(set, NULL);
+    write_check(set, "key: '%s';\n");
+    write_check(set, "%%%s\n");
+    write_check(set, "%-24s|\n");
+    write_check(set, "%.5s\n");
+
+    // ключ длиннее буфера вывода
+    const size_t long_len = 3 * 1024 * 1024;
+    char *long_key = malloc(long_len + 1);
+    assert(long_key);
+    memset(long_key, 'x', long_len);
+    long_key[long_len] = 0;
+    strset_add(set, long_key);
+    free(long_key);
+
+    write_check(set, "%s\n");
+    write_check(set, "[%s]\n");
+
+    // через FILE с уже записанными, но не сброшенными данными
+    FILE *f = tmpfile();
+    munit_assert_not_null(f);
+    fprintf(f, "header\n");
+    munit_assert(strset_write_f(set, f, "%s\n"));
+    fprintf(f, "footer\n");
+    size_t size = 0;
+    char *buf = file_read_all(f, &size);
+    munit_assert(!strncmp(buf, "header\n", 7));
+    munit_assert_string_equal(buf + size - 7, "footer\n");
+    free(buf);
+    fclose(f);
+
+    strset_free(set);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+// Построчная загрузка через getline() для сравнения
+static StrSet *set_from_getline(FILE *f) {
+    StrSet *set = strset_new(NULL);
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, f)) >= 0) {
+        if (len && line[len - 1] == '\n')
+            line[len - 1] = 0;
+        strset_add(set, line);
+    }
+    free(line);
+    return set;
+}
+
+static bool line_count(char *line, size_t len, void *udata) {
+    munit_assert(strlen(line) == len);
+    (*(size_t*)udata)++;
+    return true;
+}
+
+// Для замера скорости, без проверок
+static bool line_count_fast(char *line, size_t len, void *udata) {
+    (*(size_t*)udata)++;
+    return true;
+}
+
+static bool line_stop(char *line, size_t len, void *udata) {
+    return ++(*(size_t*)udata) < 3;
+}
+
+static void add_file_check(FILE *f, uint32_t flags, size_t lines_expected) {
+    int fd = fileno(f);
+    fflush(f);
+
+    lseek(fd, 0, SEEK_SET);
+    size_t lines_num = 0;
+    munit_assert(strset_fd_each_line(fd, flags, line_count, &lines_num));
+    munit_assert(lines_num == lines_expected);
+
+    lseek(fd, 0, SEEK_SET);
+    lines_num = 0;
+    munit_assert(strset_fd_each_line(fd, flags, line_stop, &lines_num));
+    munit_assert(lines_num == (lines_expected < 3 ? lines_expected : 3));
+}
+
+static MunitResult test_add_file(
+    const MunitParameter params[], void* data
+) {
+    // тот же набор, что и построчно через getline()
+    FILE *file_data = fopen("./strset_data1.txt", "r");
+    munit_assert_not_null(file_data);
+    StrSet *expected = set_from_getline(file_data);
+    fclose(file_data);
+
+    StrSet *set = strset_new(NULL);
+    munit_assert(strset_add_file(set, "./strset_data1.txt", 0));
+    munit_assert(strset_compare(set, expected));
+    munit_assert(!strset_add_file(set, "./strset_data1.txt.none", 0));
+    strset_free(set);
+    strset_free(expected);
+
+    // концы строк, пробелы и строки длиннее буфера чтения
+    FILE *f = tmpfile();
+    munit_assert_not_null(f);
+    const size_t long_len = 3 * 1024 * 1024 + 7;
+    char *long_line = malloc(long_len + 1);
+    assert(long_line);
+    for (size_t i = 0; i < long_len; i++)
+        long_line[i] = 'a' + i % 26;
+    long_line[long_len] = 0;
+
+    char line600[601] = {};
+    memset(line600, 'z', 600);
+
+    fprintf(f, "crlf\r\n");
+    fprintf(f, "  spaces \t\n");
+    fprintf(f, "\n");
+    fprintf(f, "%s\n", line600);
+    fprintf(f, "%s\n", long_line);
+    fprintf(f, " \r\n");
+    fprintf(f, "last");
+
+    add_file_check(f, 0, 7);
+    add_file_check(f, SSR_skip_empty, 6);
+    add_file_check(f, SSR_trim_space | SSR_skip_empty, 5);
+
+    set = strset_new(NULL);
+    lseek(fileno(f), 0, SEEK_SET);
+    munit_assert(strset_add_fd(set, fileno(f), SSR_trim_cr));
+    munit_assert(strset_count(set) == 7);
+    munit_assert(strset_exist(set, "crlf"));
+    munit_assert(strset_exist(set, "  spaces \t"));
+    munit_assert(strset_exist(set, ""));
+    munit_assert(strset_exist(set, " "));
+    munit_assert(strset_exist(set, line600));
+    munit_assert(strset_exist(set, long_line));
+    munit_assert(strset_exist(set, "last"));
+
+    strset_clear(set);
+    lseek(fileno(f), 0, SEEK_SET);
+    munit_assert(strset_add_fd(set, fileno(f), SSR_trim_space));
+    munit_assert(strset_count(set) == 6);
+    munit_assert(strset_exist(set, "spaces"));
+    munit_assert(strset_exist(set, ""));
+    munit_assert(!strset_exist(set, " "));
+    munit_assert(strset_exist(set, long_line));
+    strset_free(set);
+    free(long_line);
+    fclose(f);
+
+    // скорость на большом файле
+    const int lines_num = 1000000;
+    char **lines = lines_random_new(lines_num, 61);
+    f = tmpfile();
+    munit_assert_not_null(f);
+    for (int i = 0; i < lines_num; i++)
+        fprintf(f, "sfx_init: without suffix '%s'\n", lines[i]);
+    fflush(f);
+    lines_free(lines, lines_num);
+
+    // только разбиение на строки, без добавления в набор
+    fseek(f, 0, SEEK_SET);
+    double start = time_now();
+    size_t fgets_lines = 0;
+    char line[512] = {};
+    while (fgets(line, sizeof(line), f)) {
+        size_t line_len = strlen(line);
+        if (line[line_len - 1] == '\n')
+            line[line_len - 1] = 0;
+        fgets_lines++;
+    }
+    double fgets_split_time = time_now() - start;
+
+    lseek(fileno(f), 0, SEEK_SET);
+    start = time_now();
+    size_t each_lines = 0;
+    munit_assert(strset_fd_each_line(fileno(f), 0, line_count_fast, &each_lines));
+    double each_split_time = time_now() - start;
+    munit_assert(fgets_lines == (size_t)lines_num);
+    munit_assert(each_lines == (size_t)lines_num);
+
+    fseek(f, 0, SEEK_SET);
+    start = time_now();
+    expected = strset_new(NULL);
+    while (fgets(line, sizeof(line), f)) {
+        size_t line_len = strlen(line);
+        if (line[line_len - 1] == '\n')
+            line[line_len - 1] = 0;
+        strset_add(expected, line);
+    }
+    double fgets_time = time_now() - start;
+
+    set = strset_new(NULL);
+    lseek(fileno(f), 0, SEEK_SET);
+    start = time_now();
+    munit_assert(strset_add_fd(set, fileno(f), 0));
+    double add_fd_time = time_now() - start;
+
+    if (verbose) {
+        printf(
+            "test_add_file: split only: fgets %.4fs, "
+            "strset_fd_each_line %.4fs\n",
+            fgets_split_time, each_split_time
+        );
+        printf(
+            "test_add_file: with strset_add: fgets %.4fs, "
+            "strset_add_fd %.4fs\n",
+            fgets_time, add_fd_time
+        );
+    }
+    munit_assert(strset_compare(set, expected));
+
+    strset_free(set);
+    strset_free(expected);
+    fclose(f);
+    return MUNIT_OK;
+}
+
+struct IngestFiles {
+    char    **paths;
+    int     num;
+    size_t  bytes;
+};
+
+static char *ingest_file_new(const char *content, size_t len) {
+    char path[] = "/tmp/strset_ingest_XXXXXX";
+    int fd = mkstemp(path);
+    munit_assert(fd >= 0);
+    munit_assert(write(fd, content, len) == (ssize_t)len);
+    close(fd);
+    return strdup(path);
+}
+
+static void ingest_files_free(struct IngestFiles *files) {
+    for (int i = 0; i < files->num; i++) {
+        unlink(files->paths[i]);
+        free(files->paths[i]);
+    }
+    free(files->paths);
+}
+
+// Файлы с пересекающимися строками, CRLF, длинными строками, без '\n' в
+// конце и пустой файл
+static struct IngestFiles ingest_files_new(int files_num, int lines_num) {
+    struct IngestFiles files = {
+        .paths = calloc(files_num + 1, sizeof(files.paths[0])),
+    };
+    char **lines = lines_random_new(lines_num * 2, 67);
+
+    for (int f = 0; f < files_num; f++) {
+        size_t cap = 1024 * 1024, len = 0;
+        char *buf = malloc(cap);
+        assert(buf);
+
+        for (int i = 0; i < lines_num; i++) {
+            const char *line = lines[(f * lines_num / 2 + i) % (lines_num * 2)];
+            size_t line_len = strlen(line);
+            if (len + line_len + 16 > cap) {
+                cap *= 2;
+                buf = realloc(buf, cap);
+                assert(buf);
+            }
+            len += sprintf(buf + len, f % 2 ? "%s\r\n" : " %s\n", line);
+        }
+
+        // строка длиннее блоков и буфера дочитывания
+        if (f == 1) {
+            size_t long_len = 200 * 1024;
+            buf = realloc(buf, len + long_len + 2);
+            assert(buf);
+            memset(buf + len, 'q', long_len);
+            len += long_len;
+            buf[len++] = '\n';
+        }
+        // без '\n' в конце
+        if (f == 2)
+            len += sprintf(buf + len, "tail_without_newline");
+
+        files.paths[files.num++] = ingest_file_new(buf, len);
+        files.bytes += len;
+        free(buf);
+    }
+
+    files.paths[files.num++] = ingest_file_new("", 0);
+    lines_free(lines, lines_num * 2);
+    return files;
+}
+
+static bool line_stop_first(char *line, size_t len, void *udata) {
+    return false;
+}
+
+struct PipeWriter {
+    int         fd;
+    const char  *data;
+};
+
+static void *pipe_writer(void *arg) {
+    struct PipeWriter *w = arg;
+    size_t len = strlen(w->data);
+    munit_assert(write(w->fd, w->data, len) == (ssize_t)len);
+    close(w->fd);
+    return NULL;
+}
+
+static void ingest_check(
+    struct IngestFiles *files, StrSet *expected, size_t lines_expected,
+    struct StrSetIngestSetup *setup
+) {
+    struct StrSetIngestStats stats = {};
+
+    StrSetSharded *sharded = strset_sharded_new(NULL);
+    munit_assert(strset_sharded_add_files(
+        sharded, (const char**)files->paths, files->num, setup, &stats
+    ));
+    munit_assert(stats.files_num == (size_t)files->num);
+    munit_assert(stats.files_failed == 0);
+    munit_assert(stats.bytes == files->bytes);
+    munit_assert(stats.lines == lines_expected);
+    munit_assert(strset_sharded_count(sharded) == strset_count(expected));
+    strset_each(expected, iter_sharded_exist, sharded);
+    strset_sharded_free(sharded);
+
+    StrSetAtomic *atomic = strset_atomic_new(NULL);
+    munit_assert(strset_atomic_add_files(
+        atomic, (const char**)files->paths, files->num, setup, &stats
+    ));
+    munit_assert(stats.lines == lines_expected);
+    munit_assert(strset_atomic_count(atomic) == strset_count(expected));
+    strset_atomic_each(atomic, iter_set_exist, expected);
+    strset_atomic_free(atomic);
+}
+
+static MunitResult test_ingest(
+    const MunitParameter params[], void* data
+) {
+    struct IngestFiles files = ingest_files_new(5, 3000);
+    const uint32_t flags_all[] = { 0, SSR_trim_cr | SSR_trim_space };
+    const size_t chunk_sizes[] = { 1, 7, 4096, 0 };
+    const int threads_nums[] = { 1, 3 };
+
+    for (int f = 0; f < 2; f++) {
+        StrSet *expected = strset_new(NULL);
+        size_t lines_expected = 0;
+        for (int i = 0; i < files.num; i++) {
+            munit_assert(strset_add_file(expected, files.paths[i], flags_all[f]));
+            munit_assert(strset_file_each_line(
+                files.paths[i], flags_all[f], line_count, &lines_expected
+            ));
+        }
+
+        for (int c = 0; c < 4; c++)
+            for (int t = 0; t < 2; t++)
+                ingest_check(
+                    &files, expected, lines_expected,
+                    &(struct StrSetIngestSetup) {
+                        .flags = flags_all[f],
+                        .threads_num = threads_nums[t],
+                        .chunk_size = chunk_sizes[c],
+                    }
+                );
+        strset_free(expected);
+    }
+
+    // отсутствующий и нечитаемый (каталог) файлы не мешают остальным,
+    // каждый считается один раз
+    struct StrSetIngestStats stats = {};
+    const char *paths[] = {
+        files.paths[0], "/tmp/strset_ingest_none", "/tmp",
+    };
+    StrSetSharded *sharded = strset_sharded_new(NULL);
+    munit_assert(!strset_sharded_add_files(
+        sharded, paths, 3, &(struct StrSetIngestSetup) { .threads_num = 4 },
+        &stats
+    ));
+    munit_assert(stats.files_num == 3);
+    munit_assert(stats.files_failed == 2);
+    StrSet *expected = strset_new(NULL);
+    strset_add_file(expected, files.paths[0], 0);
+    munit_assert(strset_sharded_count(sharded) == strset_count(expected));
+    strset_free(expected);
+    strset_sharded_free(sharded);
+
+    // остановка из cb
+    munit_assert(strset_files_each_line_parallel(
+        (const char**)files.paths, files.num,
+        &(struct StrSetIngestSetup) { .threads_num = 1, .chunk_size = 64 },
+        line_stop_first, NULL, &stats
+    ));
+    munit_assert(stats.lines == 1);
+
+    // канал читается целиком одним потоком
+    int pipe_fds[2];
+    munit_assert(!pipe(pipe_fds));
+    pthread_t writer;
+    struct PipeWriter w = {
+        .fd = pipe_fds[1],
+        .data = "one\r\ntwo\n\nthree",
+    };
+    pthread_create(&writer, NULL, pipe_writer, &w);
+    char pipe_path[64] = {};
+    snprintf(pipe_path, sizeof(pipe_path), "/dev/fd/%d", pipe_fds[0]);
+    paths[0] = pipe_path;
+    sharded = strset_sharded_new(NULL);
+    munit_assert(strset_sharded_add_files(
+        sharded, paths, 1,
+        &(struct StrSetIngestSetup) { .flags = SSR_trim_cr | SSR_skip_empty },
+        &stats
+    ));
+    pthread_join(writer, NULL);
+    close(pipe_fds[0]);
+    munit_assert(stats.lines == 3);
+    munit_assert(strset_sharded_count(sharded) == 3);
+    munit_assert(strset_sharded_exist(sharded, "one"));
+    munit_assert(strset_sharded_exist(sharded, "three"));
+    strset_sharded_free(sharded);
+    ingest_files_free(&files);
+
+    // скорость
+    files = ingest_files_new(8, 100000);
+    for (int threads_num = 1; threads_num <= 8; threads_num *= 2) {
+        sharded = strset_sharded_new(NULL);
+        strset_sharded_add_files(
+            sharded, (const char**)files.paths, files.num,
+            &(struct StrSetIngestSetup) { .threads_num = threads_num },
+            &stats
+        );
+        if (verbose) {
+            printf(
+                "test_ingest: threads %d, %zu lines, %.4fs, %.1f MB/s\n",
+                threads_num, stats.lines, stats.seconds, stats.mb_per_sec
+            );
+        }
+        strset_sharded_free(sharded);
+    }
+    ingest_files_free(&files);
+
+    return MUNIT_OK;
+}
+
+static MunitResult test_bloom(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 200000;
+    char **lines = lines_random_new(lines_num, 71);
+    // ключи, которых нет в наборе
+    char **misses = lines_random_new(lines_num, 73);
+
+    HashFunction hasher = koh_hashers[0].f;
+    StrSet *present = set_from_lines(NULL, lines, lines_num);
+
+    // фильтр сам по себе
+    StrSetBloom *bloom = strset_bloom_new(lines_num, 0);
+    munit_assert(strset_bloom_capacity(bloom) >= (size_t)lines_num);
+    for (int i = 0; i < lines_num; i++)
+        strset_bloom_add(bloom, strset_hash_str(hasher, lines[i]));
+    for (int i = 0; i < lines_num; i++)
+        munit_assert(strset_bloom_maybe(bloom, strset_hash_str(hasher, lines[i])));
+
+    size_t false_positives = 0, misses_num = 0;
+    for (int i = 0; i < lines_num; i++) {
+        if (strset_exist(present, misses[i]))
+            continue;
+        misses_num++;
+        if (strset_bloom_maybe(bloom, strset_hash_str(hasher, misses[i])))
+            false_positives++;
+    }
+    double fpr = (double)false_positives / misses_num;
+    if (verbose) {
+        printf(
+            "test_bloom: %zu bytes, false positive rate %.4f\n",
+            strset_bloom_size(bloom), fpr
+        );
+    }
+    munit_assert(fpr < 0.02);
+
+    strset_bloom_clear(bloom);
+    munit_assert(!strset_bloom_maybe(bloom, strset_hash_str(hasher, lines[0])));
+    strset_bloom_free(bloom);
+
+    // StrSetExt с фильтром: рост с маленькой емкости и удаления
+    StrSetExt *ext = strset_ext_new(&(struct StrSetExtSetup) {
+        .flags = SSX_bloom,
+    });
+    for (int i = 0; i < lines_num; i++)
+        strset_ext_add(ext, lines[i]);
+    for (int i = 0; i < lines_num; i += 3)
+        strset_ext_remove(ext, lines[i]);
+    for (int i = 0; i < lines_num; i += 9)
+        strset_ext_add(ext, lines[i]);
+
+    StrSet *control = strset_new(NULL);
+    for (int i = 0; i < lines_num; i++)
+        if (i % 3 || !(i % 9))
+            strset_add(control, lines[i]);
+    munit_assert(strset_ext_count(ext) == strset_count(control));
+    for (int i = 0; i < lines_num; i++) {
+        munit_assert(strset_ext_exist(ext, lines[i]) ==
+                     strset_exist(control, lines[i]));
+        munit_assert(strset_ext_exist(ext, misses[i]) ==
+                     strset_exist(control, misses[i]));
+    }
+
+    // почти одни промахи
+    StrSetExt *plain = strset_ext_new(NULL);
+    for (int i = 0; i < lines_num; i++)
+        strset_ext_add(plain, lines[i]);
+
+    double start = time_now();
+    size_t found_bloom = 0;
+    for (int r = 0; r < 5; r++)
+        for (int i = 0; i < lines_num; i++)
+            found_bloom += strset_ext_exist(ext, misses[i]);
+    double bloom_time = time_now() - start;
+
+    start = time_now();
+    size_t found_plain = 0;
+    for (int r = 0; r < 5; r++)
+        for (int i = 0; i < lines_num; i++)
+            found_plain += strset_ext_exist(plain, misses[i]);
+    double plain_time = time_now() - start;
+
+    if (verbose) {
+        printf(
+            "test_bloom: misses with filter %.4fs, without %.4fs\n",
+            bloom_time, plain_time
+        );
+    }
+    munit_assert(found_bloom <= found_plain);
+
+    strset_ext_clear(ext);
+    munit_assert(!strset_ext_exist(ext, lines[1]));
+    strset_ext_add(ext, lines[1]);
+    munit_assert(strset_ext_exist(ext, lines[1]));
+
+    strset_ext_free(plain);
+    strset_ext_free(ext);
+    strset_free(control);
+    strset_free(present);
+    lines_free(misses, lines_num);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_filter_internal(
+    const MunitParameter params[], void* data, struct StrFilterSetup *setup
+) {
+    const int lines_num = setup->capacity;
+    char **lines = lines_random_new(lines_num, 79);
+    char **misses = lines_random_new(lines_num, 83);
+    StrSet *present = set_from_lines(NULL, lines, lines_num);
+
+    StrFilter *filter = strfilter_new(setup);
+    for (int i = 0; i < lines_num; i++)
+        munit_assert(strfilter_add(filter, lines[i]));
+    munit_assert(strfilter_count(filter) == (size_t)lines_num);
+    for (int i = 0; i < lines_num; i++)
+        munit_assert(strfilter_exist(filter, lines[i]));
+
+    size_t false_positives = 0, misses_num = 0;
+    for (int i = 0; i < lines_num; i++) {
+        if (strset_exist(present, misses[i]))
+            continue;
+        misses_num++;
+        false_positives += strfilter_exist(filter, misses[i]);
+    }
+    double fpr = (double)false_positives / misses_num,
+           fpr_expected = 8. / (1 << setup->fingerprint_bits);
+    if (verbose) {
+        printf(
+            "test_filter: bits %d, %.2f bytes per key, "
+            "false positive rate %.5f (expected %.5f)\n",
+            setup->fingerprint_bits,
+            (double)strfilter_size(filter) / lines_num, fpr, fpr_expected
+        );
+    }
+    munit_assert(fpr < fpr_expected * 2);
+    if (setup->fingerprint_bits <= 13)
+        munit_assert(strfilter_size(filter) < 2 * (size_t)lines_num);
+
+    // удаление половины, вторая половина на месте
+    for (int i = 0; i < lines_num; i += 2)
+        munit_assert(strfilter_remove(filter, lines[i]));
+    munit_assert(strfilter_count(filter) == (size_t)lines_num / 2);
+    for (int i = 1; i < lines_num; i += 2)
+        munit_assert(strfilter_exist(filter, lines[i]));
+    size_t still = 0;
+    for (int i = 0; i < lines_num; i += 2)
+        still += strfilter_exist(filter, lines[i]);
+    munit_assert(still < lines_num * fpr_expected * 2 + 10);
+
+    // переполнение: добавленные до отказа ключи не теряются
+    strfilter_clear(filter);
+    munit_assert(!strfilter_exist(filter, lines[1]));
+    int added = 0;
+    for (int i = 0; i < lines_num; i++, added++)
+        if (!strfilter_add(filter, lines[i]) ||
+            !strfilter_add(filter, misses[i]))
+            break;
+    munit_assert(added < lines_num);
+    for (int i = 0; i < added; i++) {
+        munit_assert(strfilter_exist(filter, lines[i]));
+        munit_assert(strfilter_exist(filter, misses[i]));
+    }
+    for (int i = 0; i < added; i++) {
+        munit_assert(strfilter_remove(filter, lines[i]));
+        munit_assert(strfilter_remove(filter, misses[i]));
+    }
+    munit_assert(strfilter_add(filter, lines[0]));
+
+    strfilter_free(filter);
+    strset_free(present);
+    lines_free(misses, lines_num);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_filter(
+    const MunitParameter params[], void* data
+) {
+    const int bits[] = { 8, 13, 16 };
+    for (int i = 0; koh_hashers[i].f; i++) {
+        if (verbose)
+            printf("test_filter: using '%s' function\n", koh_hashers[i].fname);
+        for (int j = 0; j < 3; j++) {
+            test_filter_internal(params, data, &(struct StrFilterSetup) {
+                // заполнение таблицы около 92%
+                .capacity = 120000,
+                .hasher = koh_hashers[i].f,
+                .fingerprint_bits = bits[j],
+            });
+        }
+    }
+    return MUNIT_OK;
+}
+
+static MunitResult test_hll(
+    const MunitParameter params[], void* data
+) {
+    // малое число ключей
+    StrSet *set = strset_new(NULL);
+    munit_assert(strset_add_file(set, "./strset_data1.txt", 0));
+    double estimate = strhll_estimate_file("./strset_data1.txt", 0, 0, NULL);
+    double error = fabs(estimate - strset_count(set)) / strset_count(set);
+    if (verbose) {
+        printf(
+            "test_hll: strset_data1.txt, strset_count %zu, estimate %.1f\n",
+            strset_count(set), estimate
+        );
+    }
+    munit_assert(error < 0.02);
+    munit_assert(strhll_estimate_file("./strset_data1.txt.none", 0, 0, NULL) < 0);
+    strset_free(set);
+
+    StrHLL *empty = strhll_new(0, NULL);
+    munit_assert(strhll_estimate(empty) == 0.);
+    strhll_free(empty);
+
+    const int lines_num = 1000000;
+    char **lines = lines_random_new(lines_num, 89);
+    set = set_from_lines(NULL, lines, lines_num);
+    double count = strset_count(set);
+
+    const int precisions[] = { 10, 14, 16 };
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; koh_hashers[i].f; i++) {
+            StrHLL *hll = strhll_new(precisions[j], koh_hashers[i].f),
+                   *a = strhll_new(precisions[j], koh_hashers[i].f),
+                   *b = strhll_new(precisions[j], koh_hashers[i].f);
+
+            for (int k = 0; k < lines_num; k++) {
+                strhll_add(hll, lines[k]);
+                strhll_add(k % 2 ? a : b, lines[k]);
+            }
+
+            estimate = strhll_estimate(hll);
+            error = fabs(estimate - count) / count;
+            // 4 стандартных ошибки
+            double error_max = 4. * 1.04 / sqrt(1 << precisions[j]);
+            if (verbose) {
+                printf(
+                    "test_hll: precision %d, '%s', count %.0f, "
+                    "estimate %.0f, error %.4f\n",
+                    precisions[j], koh_hashers[i].fname, count, estimate,
+                    error
+                );
+            }
+            munit_assert(error < error_max);
+
+            // объединение половин дает те же регистры
+            munit_assert(strhll_merge(a, b));
+            munit_assert(strhll_estimate(a) == estimate);
+
+            // растущий поток
+            strhll_clear(a);
+            for (int k = 1; k <= 1000; k++) {
+                strhll_add(a, lines[k]);
+                if (k % 100 == 0) {
+                    double e = strhll_estimate(a);
+                    munit_assert(fabs(e - k) / k < error_max + 0.02);
+                }
+            }
+
+            StrHLL *other = strhll_new(precisions[j] + 1, koh_hashers[i].f);
+            munit_assert(!strhll_merge(hll, other));
+            strhll_free(other);
+
+            strhll_free(hll);
+            strhll_free(a);
+            strhll_free(b);
+        }
+    }
+
+    strset_free(set);
+    lines_free(lines, lines_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_minhash(
+    const MunitParameter params[], void* data
+) {
+    const int lines_num = 100000, k = 256;
+    char **lines = lines_random_new(lines_num * 2, 97);
+
+    // сдвиг окна задает пересечение
+    const double shifts[] = { 0., 0.1, 0.5, 0.9, 1. };
+    for (int s = 0; s < 5; s++) {
+        int shift = lines_num * shifts[s];
+        StrSet *a = set_from_lines(NULL, lines, lines_num),
+               *b = set_from_lines(NULL, lines + shift, lines_num);
+
+        StrSet *inter = strset_intersection(a, b, NULL),
+               *uni = strset_union(a, b, NULL);
+        double exact = (double)strset_count(inter) / strset_count(uni);
+
+        StrMinHash *ma = strset_minhash(a, k, NULL),
+                   *mb = strset_minhash(b, k, NULL);
+        double estimate = strminhash_jaccard(ma, mb);
+        if (verbose) {
+            printf(
+                "test_minhash: jaccard %.4f, estimate %.4f\n",
+                exact, estimate
+            );
+        }
+        munit_assert(strminhash_num(ma) == k);
+        // 4 стандартных ошибки и не меньше 0.01
+        munit_assert(
+            fabs(estimate - exact) <=
+            4. * sqrt(exact * (1. - exact) / k) + 0.01
+        );
+
+        strminhash_free(ma);
+        strminhash_free(mb);
+        strset_free(inter);
+        strset_free(uni);
+        strset_free(a);
+        strset_free(b);
+    }
+
+    // меньше k ключей - точная оценка
+    StrMinHash *ma = strminhash_new(k, NULL), *mb = strminhash_new(k, NULL);
+    for (int i = 0; i < 100; i++) {
+        strminhash_add(ma, lines[i]);
+        strminhash_add(ma, lines[i]);
+        strminhash_add(mb, lines[i + 50]);
+    }
+    munit_assert(strminhash_num(ma) == 100);
+    munit_assert(strminhash_jaccard(ma, mb) == 50. / 150.);
+    strminhash_clear(mb);
+    munit_assert(strminhash_jaccard(ma, mb) == 0.);
+    strminhash_clear(ma);
+    munit_assert(strminhash_jaccard(ma, mb) == 1.);
+    StrMinHash *other = strminhash_new(k / 2, NULL);
+    munit_assert(strminhash_jaccard(ma, other) < 0.);
+    strminhash_free(other);
+    strminhash_free(ma);
+    strminhash_free(mb);
+
+    // подпись StrSetExt совпадает с подписью по набору
+    StrSetExt *ext = strset_ext_new(&(struct StrSetExtSetup) {
+        .flags = SSX_minhash,
+        .minhash_k = k,
+    });
+    for (int i = 0; i < lines_num; i++)
+        strset_ext_add(ext, lines[i]);
+    ma = strset_minhash(strset_ext_set(ext), k, NULL);
+    munit_assert(strminhash_jaccard(strset_ext_minhash(ext), ma) == 1.);
+    strminhash_free(ma);
+
+    for (int i = 0; i < lines_num; i += 2)
+        strset_ext_remove(ext, lines[i]);
+    ma = strset_minhash(strset_ext_set(ext), k, NULL);
+    munit_assert(strminhash_jaccard(strset_ext_minhash(ext), ma) == 1.);
+    strminhash_free(ma);
+
+    for (int i = lines_num; i < lines_num * 2; i++)
+        strset_ext_add(ext, lines[i]);
+    ma = strset_minhash(strset_ext_set(ext), k, NULL);
+    munit_assert(strminhash_jaccard(strset_ext_minhash(ext), ma) == 1.);
+    strminhash_free(ma);
+
+    strset_ext_free(ext);
+    lines_free(lines, lines_num * 2);
+    return MUNIT_OK;
+}
+
+struct CountCheck {
+    StrCount    *expected;
+    size_t      visited;
+    int64_t     total;
+};
+
+static StrSetAction iter_count_check(
+    const char *key, int64_t count, void *udata
+) {
+    struct CountCheck *check = udata;
+    munit_assert(strcount_get(check->expected, key) == count);
+    check->visited++;
+    check->total += count;
+    return SSA_next;
+}
+
+static StrSetAction iter_count_remove_odd(
+    const char *key, int64_t count, void *udata
+) {
+    return count % 2 ? SSA_remove : SSA_next;
+}
+
+static MunitResult test_count(
+    const MunitParameter params[], void* data
+) {
+    // частоты строк лога против подсчета по отсортированному массиву
+    StrCount *cnt = strcount_new(NULL);
+    munit_assert(strcount_add_file(cnt, "./strset_data1.txt", 0));
+
+    char *buf = NULL;
+    size_t buf_size = 0;
+    FILE *f = fopen("./strset_data1.txt", "r");
+    munit_assert_not_null(f);
+    buf = file_read_all(f, &buf_size);
+    fclose(f);
+    size_t lines_num = 0;
+    const char **lines = file_lines_sorted(buf, &lines_num);
+
+    size_t distinct = 0;
+    for (size_t i = 0, j; i < lines_num; i = j) {
+        for (j = i; j < lines_num && !strcmp(lines[i], lines[j]); j++);
+        munit_assert(strcount_get(cnt, lines[i]) == (int64_t)(j - i));
+        distinct++;
+    }
+    munit_assert(strcount_count(cnt) == distinct);
+    munit_assert(strcount_total(cnt) == (int64_t)lines_num);
+    if (verbose) {
+        printf(
+            "test_count: %zu lines, %zu distinct, 'sfx_init: without "
+            "suffix laser' %" PRId64 " times\n", lines_num, distinct,
+            strcount_get(cnt, "sfx_init: without suffix laser")
+        );
+    }
+    free(lines);
+    free(buf);
+    strcount_free(cnt);
+
+    // случайные inc/dec против второго счетчика на StrSet + массиве
+    const int keys_num = 20000;
+    char **keys = lines_random_new(keys_num, 101);
+    cnt = strcount_new(&(struct StrSetSetup) { .capacity = 4 });
+    int64_t *expected = calloc(keys_num, sizeof(expected[0]));
+    xorshift32_state rnd = { 103 };
+
+    for (int r = 0; r < 200000; r++) {
+        int i = xorshift32_rand(&rnd) % keys_num;
+        int64_t delta = xorshift32_rand(&rnd) % 5 + 1;
+        if (xorshift32_rand(&rnd) % 3) {
+            expected[i] += delta;
+            munit_assert(strcount_inc(cnt, keys[i], delta) == expected[i]);
+        } else {
+            expected[i] = expected[i] > delta ? expected[i] - delta : 0;
+            munit_assert(strcount_dec(cnt, keys[i], delta) == expected[i]);
+        }
+    }
+
+    int64_t total = 0;
+    size_t present = 0;
+    for (int i = 0; i < keys_num; i++) {
+        munit_assert(strcount_get(cnt, keys[i]) == expected[i]);
+        munit_assert(strcount_exist(cnt, keys[i]) == (expected[i] > 0));
+        total += expected[i];
+        present += expected[i] > 0;
+    }
+    munit_assert(strcount_count(cnt) == present);
+    munit_assert(strcount_total(cnt) == total);
+
+    struct CountCheck check = { .expected = cnt };
+    strcount_each(cnt, iter_count_check, &check);
+    munit_assert(check.visited == present);
+    munit_assert(check.total == total);
+
+    // удаление из обхода
+    strcount_each(cnt, iter_count_remove_odd, NULL);
+    for (int i = 0; i < keys_num; i++) {
+        int64_t left = expected[i] % 2 ? 0 : expected[i];
+        munit_assert(strcount_get(cnt, keys[i]) == left);
+    }
+
+    strcount_remove(cnt, keys[0]);
+    munit_assert(!strcount_exist(cnt, keys[0]));
+    strcount_clear(cnt);
+    munit_assert(strcount_count(cnt) == 0 && strcount_total(cnt) == 0);
+    munit_assert(strcount_inc(cnt, keys[1], 1) == 1);
+
+    free(expected);
+    strcount_free(cnt);
+    lines_free(keys, keys_num);
+    return MUNIT_OK;
+}
+
+struct MapValue {
+    int     id;
+    double  weight;
+    char    tag[12];
+};
+
+struct LineInfo {
+    size_t  first, count;
+};
+
+struct MapLines {
+    StrMap  *map;
+    size_t  line;
+};
+
+static bool line_map_info(char *line, size_t len, void *udata) {
+    struct MapLines *ml = udata;
+    bool inserted = false;
+    struct LineInfo *info = strmap_get_or_insert(ml->map, line, &inserted);
+    if (inserted)
+        info->first = ml->line;
+    info->count++;
+    ml->line++;
+    return true;
+}
+
+static StrSetAction iter_map_check(const char *key, void *value, void *udata) {
+    StrCount *cnt = udata;
+    struct LineInfo *info = value;
+    munit_assert(strcount_get(cnt, key) == (int64_t)info->count);
+    return SSA_next;
+}
+
+static StrSetAction iter_map_remove_even(
+    const char *key, void *value, void *udata
+) {
+    struct MapValue *v = value;
+    return v->id % 2 ? SSA_next : SSA_remove;
+}
+
+static MunitResult test_map(
+    const MunitParameter params[], void* data
+) {
+    const int keys_num = 50000;
+    char **keys = lines_random_new(keys_num, 107);
+    StrSet *control = set_from_lines(NULL, keys, keys_num);
+
+    StrMap *map = strmap_new(&(struct StrMapSetup) {
+        .value_size = sizeof(struct MapValue),
+    });
+    for (int i = 0; i < keys_num; i++) {
+        struct MapValue v = { .id = i, .weight = i * 0.5 };
+        snprintf(v.tag, sizeof(v.tag), "t%d", i % 1000);
+        strmap_put(map, keys[i], &v);
+    }
+    munit_assert(strmap_count(map) == strset_count(control));
+
+    // при повторах ключа остается последнее значение
+    for (int i = 0; i < keys_num; i++) {
+        struct MapValue *v = strmap_get(map, keys[i]);
+        munit_assert_not_null(v);
+        munit_assert(!strcmp(keys[v->id], keys[i]));
+        munit_assert(v->weight == v->id * 0.5);
+    }
+    munit_assert_null(strmap_get(map, "no such key"));
+
+    bool inserted = true;
+    struct MapValue *v = strmap_get_or_insert(map, keys[7], &inserted);
+    munit_assert(!inserted && !strcmp(keys[v->id], keys[7]));
+    v = strmap_get_or_insert(map, "new key", &inserted);
+    munit_assert(inserted && v->id == 0 && v->weight == 0.);
+    v->id = 1;
+    munit_assert(strmap_remove(map, "new key"));
+    munit_assert(!strmap_remove(map, "new key"));
+
+    strmap_each(map, iter_map_remove_even, NULL);
+    for (int i = 0; i < keys_num; i++) {
+        v = strmap_get(map, keys[i]);
+        munit_assert(!v || v->id % 2);
+    }
+    strmap_clear(map);
+    munit_assert(strmap_count(map) == 0);
+    strmap_free(map);
+
+    // значения-указатели
+    map = strmap_new(NULL);
+    for (int i = 0; i < keys_num; i++)
+        strmap_put_ptr(map, keys[i], keys[i]);
+    for (int i = 0; i < keys_num; i++)
+        munit_assert(!strcmp(strmap_get_ptr(map, keys[i]), keys[i]));
+    munit_assert_null(strmap_get_ptr(map, "no such key"));
+    strmap_free(map);
+
+    // значения, которым нужно выравнивание 16 байт
+    map = strmap_new(&(struct StrMapSetup) {
+        .value_size = sizeof(long double),
+    });
+    for (int i = 0; i < keys_num; i++) {
+        long double *value = strmap_get_or_insert(map, keys[i], NULL);
+        munit_assert((uintptr_t)value % _Alignof(long double) == 0);
+        *value = i / 3.L;
+    }
+    for (int i = 0; i < keys_num; i++) {
+        long double *value = strmap_get(map, keys[i]);
+        munit_assert((uintptr_t)value % _Alignof(long double) == 0);
+        munit_assert(*value == i / 3.L);
+    }
+    strmap_free(map);
+
+    // данные к строкам лога без отдельной хэш-таблицы и записей по 512 байт
+    struct MapLines ml = {
+        .map = strmap_new(&(struct StrMapSetup) {
+            .value_size = sizeof(struct LineInfo),
+        }),
+    };
+    munit_assert(strset_file_each_line(
+        "./strset_data1.txt", 0, line_map_info, &ml
+    ));
+    StrCount *cnt = strcount_new(NULL);
+    strcount_add_file(cnt, "./strset_data1.txt", 0);
+    munit_assert(strmap_count(ml.map) == strcount_count(cnt));
+    strmap_each(ml.map, iter_map_check, cnt);
+    struct LineInfo *info = strmap_get(ml.map, "sfx_init:");
+    munit_assert_not_null(info);
+    if (verbose) {
+        printf(
+            "test_map: 'sfx_init:' first at line %zu, %zu times\n",
+            info->first + 1, info->count
+        );
+    }
+    strcount_free(cnt);
+    strmap_free(ml.map);
+
+    strset_free(control);
+    lines_free(keys, keys_num);
+    return MUNIT_OK;
+}
+
+struct TopKExact {
+    StrTopKItem *items;
+    size_t      num;
+};
+
+static StrSetAction iter_topk_exact(
+    const char *key, int64_t count, void *udata
+) {
+    struct TopKExact *exact = udata;
+    exact->items[exact->num++] = (StrTopKItem) {
+        .key = key,
+        .count = count,
+    };
+    return SSA_next;
+}
+
+static int cmp_topk_items(const void *a, const void *b) {
+    const StrTopKItem *x = a, *y = b;
+    return x->count < y->count ? 1 : x->count > y->count ? -1 : 0;
+}
+
+static MunitResult test_topk(
+    const MunitParameter params[], void* data
+) {
+    // поток с распределением Ципфа: ключ i встречается примерно 1 / i раз
+    const int keys_num = 100000, stream_len = 2000000;
+    char **keys = lines_random_new(keys_num, 109);
+    double *cdf = malloc(sizeof(cdf[0]) * keys_num), sum = 0.;
+    for (int i = 0; i < keys_num; i++)
+        cdf[i] = sum += 1. / (i + 1);
+
+    struct StrTopKSetup setup = { .counters = 500 };
+    StrTopK *tk = strtopk_new(&setup);
+    StrCount *cnt = strcount_new(NULL);
+    xorshift32_state rnd = { 113 };
+    for (int r = 0; r < stream_len; r++) {
+        double x = (double)xorshift32_rand(&rnd) / UINT32_MAX * sum;
+        int lo = 0, hi = keys_num - 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (cdf[mid] < x)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        strtopk_add(tk, keys[lo], 1);
+        strcount_inc(cnt, keys[lo], 1);
+    }
+    munit_assert(strtopk_total(tk) == (uint64_t)stream_len);
+
+    struct TopKExact exact = {
+        .items = malloc(sizeof(StrTopKItem) * strcount_count(cnt)),
+    };
+    strcount_each(cnt, iter_topk_exact, &exact);
+    qsort(exact.items, exact.num, sizeof(exact.items[0]), cmp_topk_items);
+
+    const size_t top = 20;
+    StrTopKItem items[20];
+    munit_assert(strtopk_list(tk, items, top) == top);
+
+    uint64_t error_max = stream_len / setup.counters;
+    for (size_t i = 0; i < top; i++) {
+        uint64_t real = strcount_get(cnt, items[i].key);
+        munit_assert(items[i].count - items[i].error <= real);
+        munit_assert(real <= items[i].count);
+        munit_assert(items[i].error <= error_max);
+        if (i)
+            munit_assert(items[i - 1].count >= items[i].count);
+    }
+
+    // ключи чаще total / counters обязаны быть в списке
+    StrTopKItem *all = malloc(sizeof(all[0]) * setup.counters);
+    size_t all_num = strtopk_list(tk, all, setup.counters);
+    munit_assert(all_num == setup.counters);
+    StrSet *listed = strset_new(NULL);
+    for (size_t i = 0; i < all_num; i++)
+        strset_add(listed, all[i].key);
+    for (size_t i = 0; i < exact.num && exact.items[i].count > error_max; i++)
+        munit_assert(strset_exist(listed, exact.items[i].key));
+
+    // первые ключи распределения разделены хорошо, порядок точный
+    for (size_t i = 0; i < 5; i++)
+        munit_assert_string_equal(items[i].key, exact.items[i].key);
+
+    if (verbose) {
+        for (size_t i = 0; i < 5; i++) {
+            printf(
+                "test_topk: '%s' count %" PRIu64 " error %" PRIu64
+                " real %" PRId64 "\n", items[i].key, items[i].count,
+                items[i].error, strcount_get(cnt, items[i].key)
+            );
+        }
+    }
+
+    // самая частая строка лога
+    strtopk_clear(tk);
+    munit_assert(strtopk_add_file(tk, "./strset_data1.txt", 0));
+    strcount_clear(cnt);
+    strcount_add_file(cnt, "./strset_data1.txt", 0);
+    exact.num = 0;
+    strcount_each(cnt, iter_topk_exact, &exact);
+    qsort(exact.items, exact.num, sizeof(exact.items[0]), cmp_topk_items);
+    munit_assert(strtopk_list(tk, items, 1) == 1);
+    munit_assert(items[0].count == exact.items[0].count);
+    if (verbose) {
+        printf(
+            "test_topk: strset_data1.txt top '%s' %" PRIu64 " times\n",
+            items[0].key, items[0].count
+        );
+    }
+
+    strset_free(listed);
+    free(all);
+    free(exact.items);
+    free(cdf);
+    strcount_free(cnt);
+    strtopk_free(tk);
+    lines_free(keys, keys_num);
+    return MUNIT_OK;
+}
+
+static MunitResult test_symtab(
+    const MunitParameter params[], void* data
+) {
+    const int names_num = 3000, stream_len = 200000;
+    char **names = calloc(names_num, sizeof(names[0]));
+    for (int i = 0; i < names_num; i++) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "stage_add: name 'stage_%d'", i);
+        names[i] = strdup(buf);
+    }
+
+    StrSymtab *sym = strsym_new(NULL);
+    const char **canon = calloc(names_num, sizeof(canon[0]));
+    for (int i = 0; i < names_num; i++) {
+        uint32_t id = UINT32_MAX;
+        canon[i] = strsym_intern(sym, names[i], &id);
+        munit_assert(id == (uint32_t)i);
+        munit_assert(canon[i] != names[i]);
+        munit_assert_string_equal(canon[i], names[i]);
+    }
+    munit_assert(strsym_count(sym) == (uint32_t)names_num);
+
+    // повторы дают тот же указатель и номер, таблица растет между ними
+    xorshift32_state rnd = { 127 };
+    for (int r = 0; r < stream_len; r++) {
+        int i = xorshift32_rand(&rnd) % names_num;
+        char buf[64];
+        strcpy(buf, names[i]);
+        uint32_t id = UINT32_MAX;
+        munit_assert(strsym_intern(sym, buf, &id) == canon[i]);
+        munit_assert(id == (uint32_t)i);
+        munit_assert(strsym_name(sym, id) == canon[i]);
+        munit_assert(strsym_name_len(sym, id) == strlen(names[i]));
+    }
+    munit_assert(strsym_count(sym) == (uint32_t)names_num);
+
+    // строка без завершающего нуля
+    const char *line = "stage_add: name 'stage_7' tail";
+    uint32_t id = UINT32_MAX;
+    munit_assert(strsym_intern_len(sym, line, 25, &id) == canon[7]);
+    munit_assert(id == 7);
+
+    munit_assert(strsym_find(sym, names[42], &id));
+    munit_assert(id == 42);
+    munit_assert(!strsym_find(sym, "stage_add: name 'main_menu'", &id));
+    munit_assert(strsym_count(sym) == (uint32_t)names_num);
+
+    uint32_t menu = UINT32_MAX;
+    strsym_intern(sym, "stage_add: name 'main_menu'", &menu);
+    munit_assert(menu == (uint32_t)names_num);
+    munit_assert(strsym_find(sym, "stage_add: name 'main_menu'", NULL));
+
+    // пустая строка - тоже символ
+    munit_assert_string_equal(strsym_intern(sym, "", &id), "");
+    munit_assert(id == (uint32_t)names_num + 1);
+
+    strsym_clear(sym);
+    munit_assert(strsym_count(sym) == 0);
+    munit_assert(!strsym_find(sym, names[0], NULL));
+    strsym_intern(sym, names[5], &id);
+    munit_assert(id == 0);
+
+    if (verbose) {
+        // сравнение номеров против strcmp() по тем же строкам
+        uint32_t *ids = malloc(sizeof(ids[0]) * names_num);
+        strsym_clear(sym);
+        for (int i = 0; i < names_num; i++)
+            strsym_intern(sym, names[i], &ids[i]);
+
+        size_t eq_str = 0, eq_id = 0;
+        double t = time_now();
+        for (int r = 0; r < stream_len * 10; r++) {
+            int a = r % names_num, b = (r * 7) % names_num;
+            eq_str += !strcmp(names[a], names[b]);
+        }
+        double t_str = time_now() - t;
+        t = time_now();
+        for (int r = 0; r < stream_len * 10; r++) {
+            int a = r % names_num, b = (r * 7) % names_num;
+            eq_id += ids[a] == ids[b];
+        }
+        double t_id = time_now() - t;
+        munit_assert(eq_str == eq_id);
+        printf(
+            "test_symtab: strcmp %.4fs, id compare %.4fs\n", t_str, t_id
+        );
+        free(ids);
+    }
+
+    strsym_free(sym);
+    free(canon);
+    lines_free(names, names_num);
+    return MUNIT_OK;
+}
+
+static MunitTest test_suite_tests[] = {
+  {
+    (char*) "/new_add_exist_free",
+    test_new_add_exist_free,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+  {
+    (char*) "/massive_add_get",
+    test_massive_add_get,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+  {
+    (char*) "/compare",
+    test_compare,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/difference",
+    test_difference,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/compare_with_uthash",
+    test_compare_with_uthash,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  /*
+    {
+      (char*) "/add_remove4",
+      test_add_remove4,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL
+    },
+*/
+
+    {
+      (char*) "/add_remove2",
+      test_add_remove2,
+      NULL,
+      NULL,
+      MUNIT_TEST_OPTION_NONE,
+      NULL
+    },
+
+/*
+  {
+    (char*) "/stress",
+    test_stress,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+*/
+
+  {
+    (char*) "/iter",
+    test_iter,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/sharded",
+    test_sharded,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/sharded_scaling",
+    test_sharded_scaling,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/atomic",
+    test_atomic,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/fc",
+    test_fc,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/build_parallel",
+    test_build_parallel,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/ops",
+    test_ops,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/ops_parallel",
+    test_ops_parallel,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/views",
+    test_views,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/ops_many",
+    test_ops_many,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/ext_compare",
+    test_ext_compare,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/frozen",
+    test_frozen,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/each_parallel",
+    test_each_parallel,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/sorted",
+    test_sorted,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/write",
+    test_write,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/add_file",
+    test_add_file,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/ingest",
+    test_ingest,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/bloom",
+    test_bloom,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/filter",
+    test_filter,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/hll",
+    test_hll,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/minhash",
+    test_minhash,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/count",
+    test_count,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/map",
+    test_map,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/topk",
+    test_topk,
+    NULL,
+    NULL,
+    MUNIT_TEST_OPTION_NONE,
+    NULL
+  },
+
+  {
+    (char*) "/symtab",
+    test_symtab,
     NULL,
     NULL,
     MUNIT_TEST_OPTION_NONE,
     NULL
   },
-  */
 
   { NULL, NULL, NULL, NULL, MUNIT_TEST_OPTION_NONE, NULL }
 };
@@ -0,0 +1,391 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+// strset_uniq - уникальные строки входа в порядке первого появления.
+// Замена для `sort -u` и `awk '!seen[$0]++'`, не сортирует и не держит вход
+// в памяти, только набор уже встреченных строк.
+
+#include "koh_hashers.h"
+#include "koh_strset.h"
+#include "strset_hash.h"
+#include "strmap.h"
+#include "strset_io.h"
+#include <assert.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Примерный расход StrSet на ключ сверх самой строки
+#define STRSET_KEY_OVERHEAD 32
+#define OUT_BUF_SIZE        (1024 * 1024)
+
+typedef enum Engine {
+    // точный набор строк
+    E_strset,
+    // только 64-битные хэши строк, до 16 байт на строку. Младший бит хэша
+    // занят признаком слота, остается 63 бита и ложные совпадения с
+    // вероятностью порядка n^2 / 2^64
+    E_hash64,
+} Engine;
+
+// Открытая адресация по 64-битному хэшу, 0 - пустой слот
+struct Table {
+    uint64_t    *hashes;
+    size_t      cap, num;
+};
+
+// Значение StrMap в режиме подсчета
+struct Counted {
+    // номер в порядке первого появления
+    size_t  order, count;
+};
+
+struct CountedKey {
+    const char  *key;
+    size_t      count;
+};
+
+struct Uniq {
+    HashFunction    hasher;
+    Engine          engine;
+    bool            count_mode;
+    // 0 - без ограничения
+    size_t          budget, used;
+
+    StrSet          *set;
+    struct Table    table;
+
+    // режим подсчета
+    StrMap          *counted;
+
+    size_t          lines, bytes;
+};
+
+// {{{ Таблица хэшей
+
+static void table_init(struct Table *t, size_t cap) {
+    t->cap = cap;
+    t->num = 0;
+    t->hashes = calloc(cap, sizeof(t->hashes[0]));
+    assert(t->hashes);
+}
+
+static void table_shutdown(struct Table *t) {
+    free(t->hashes);
+    memset(t, 0, sizeof(*t));
+}
+
+static size_t table_slot(struct Table *t, uint64_t h) {
+    return h & (t->cap - 1);
+}
+
+// Вставка без проверки повторов
+static void table_put(struct Table *t, uint64_t h) {
+    size_t i = table_slot(t, h);
+    while (t->hashes[i])
+        i = (i + 1) & (t->cap - 1);
+    t->hashes[i] = h;
+    t->num++;
+}
+
+static void table_grow(struct Table *t) {
+    // заполнение не больше половины
+    if ((t->num + 1) * 2 <= t->cap)
+        return;
+
+    struct Table old = *t;
+    table_init(t, old.cap ? old.cap * 2 : 1024);
+    for (size_t i = 0; i < old.cap; i++)
+        if (old.hashes[i])
+            table_put(t, old.hashes[i]);
+    table_shutdown(&old);
+}
+
+// Хэш строки для таблицы, никогда не 0
+static uint64_t table_hash(struct Uniq *u, const char *line, size_t len) {
+    return strset_hash(u->hasher, line, len) | 1;
+}
+
+static bool table_add(struct Table *t, uint64_t h) {
+    table_grow(t);
+    size_t i = table_slot(t, h);
+    for (; t->hashes[i]; i = (i + 1) & (t->cap - 1))
+        if (t->hashes[i] == h)
+            return false;
+    t->hashes[i] = h;
+    t->num++;
+    return true;
+}
+
+// }}}
+
+// {{{ Вывод
+
+static char   out_buf[OUT_BUF_SIZE];
+static size_t out_used;
+
+static void out_flush() {
+    if (out_used && fwrite(out_buf, 1, out_used, stdout) != out_used) {
+        perror("strset_uniq: write");
+        exit(EXIT_FAILURE);
+    }
+    out_used = 0;
+}
+
+static void out_line(const char *line, size_t len) {
+    if (out_used + len + 1 > OUT_BUF_SIZE) {
+        out_flush();
+        if (len + 1 > OUT_BUF_SIZE) {
+            fwrite(line, 1, len, stdout);
+            fputc('\n', stdout);
+            return;
+        }
+    }
+    memcpy(out_buf + out_used, line, len);
+    out_used += len;
+    out_buf[out_used++] = '\n';
+}
+
+// }}}
+
+static StrSetAction iter_to_table(const char *key, void *udata) {
+    struct Uniq *u = udata;
+    table_add(&u->table, table_hash(u, key, strlen(key)));
+    return SSA_next;
+}
+
+// Набор перестал помещаться в бюджет - дальше только хэши
+static void uniq_to_hash64(struct Uniq *u) {
+    fprintf(
+        stderr,
+        "strset_uniq: memory budget %zu exceeded after %zu keys, "
+        "switching to hash64\n",
+        u->budget, strset_count(u->set)
+    );
+    table_init(&u->table, 1024);
+    strset_each(u->set, iter_to_table, u);
+    strset_free(u->set);
+    u->set = NULL;
+    u->engine = E_hash64;
+}
+
+static bool uniq_add(struct Uniq *u, const char *line, size_t len) {
+    if (u->engine == E_hash64)
+        return table_add(&u->table, table_hash(u, line, len));
+
+    size_t count = strset_count(u->set);
+    strset_add(u->set, line);
+    if (strset_count(u->set) == count)
+        return false;
+
+    u->used += len + 1 + STRSET_KEY_OVERHEAD;
+    if (u->budget && u->used > u->budget)
+        uniq_to_hash64(u);
+    return true;
+}
+
+// Подсчет всегда точный, ключи хранит StrMap
+static void uniq_count(struct Uniq *u, const char *line) {
+    bool inserted = false;
+    struct Counted *c = strmap_get_or_insert(u->counted, line, &inserted);
+    if (inserted)
+        c->order = strmap_count(u->counted) - 1;
+    c->count++;
+}
+
+static StrSetAction iter_counted(const char *key, void *value, void *udata) {
+    struct CountedKey *ordered = udata;
+    struct Counted *c = value;
+    ordered[c->order] = (struct CountedKey) {
+        .key = key,
+        .count = c->count,
+    };
+    return SSA_next;
+}
+
+static bool on_line(char *line, size_t len, void *udata) {
+    struct Uniq *u = udata;
+    u->lines++;
+    u->bytes += len + 1;
+
+    if (u->count_mode)
+        uniq_count(u, line);
+    else if (uniq_add(u, line, len))
+        out_line(line, len);
+    return true;
+}
+
+static size_t size_parse(const char *s) {
+    char *end = NULL;
+    double value = strtod(s, &end);
+    switch (*end) {
+        case 'k': case 'K': value *= 1024.; break;
+        case 'm': case 'M': value *= 1024. * 1024.; break;
+        case 'g': case 'G': value *= 1024. * 1024. * 1024.; break;
+        case 0: break;
+        default: return 0;
+    }
+    return value > 0. ? (size_t)value : 0;
+}
+
+static void usage(FILE *f) {
+    fprintf(
+        f,
+        "usage: strset_uniq [options] [file ...]\n"
+        "Print unique lines of files (or stdin, also '-') in the order of\n"
+        "first occurrence.\n"
+        "  -c          print '<count> <line>' for every unique line at the\n"
+        "              end, always exact, -e and -m are ignored\n"
+        "  -e engine   strset (exact, default) or hash64 (16 bytes per line,\n"
+        "              false duplicates possible)\n"
+        "  -H hasher   hash function by name, -H list prints names\n"
+        "  -m size     memory budget with k/M/G suffix, strset engine\n"
+        "              switches to hash64 when it is exceeded\n"
+        "  -t          strip trailing '\\r'\n"
+        "  -s          print statistics to stderr\n"
+        "  -h          this help\n"
+    );
+}
+
+int main(int argc, char **argv) {
+    koh_hashers_init();
+
+    struct Uniq u = {
+        .hasher = koh_hashers[0].f,
+        .engine = E_strset,
+    };
+    uint32_t flags = 0;
+    bool stats = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "ce:H:m:tsh")) != -1) {
+        switch (opt) {
+            case 'c':
+                u.count_mode = true;
+                break;
+            case 'e':
+                if (!strcmp(optarg, "strset"))
+                    u.engine = E_strset;
+                else if (!strcmp(optarg, "hash64"))
+                    u.engine = E_hash64;
+                else {
+                    fprintf(
+                        stderr, "strset_uniq: unknown engine '%s'\n", optarg
+                    );
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'H': {
+                bool list = !strcmp(optarg, "list");
+                HashFunction hasher = NULL;
+                for (int i = 0; koh_hashers[i].f; i++) {
+                    if (list)
+                        printf("%s\n", koh_hashers[i].fname);
+                    else if (!strcmp(optarg, koh_hashers[i].fname))
+                        hasher = koh_hashers[i].f;
+                }
+                if (list)
+                    return EXIT_SUCCESS;
+                if (!hasher) {
+                    fprintf(
+                        stderr, "strset_uniq: unknown hasher '%s'\n", optarg
+                    );
+                    return EXIT_FAILURE;
+                }
+                u.hasher = hasher;
+                break;
+            }
+            case 'm':
+                u.budget = size_parse(optarg);
+                if (!u.budget) {
+                    fprintf(stderr, "strset_uniq: bad size '%s'\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 't':
+                flags |= SSR_trim_cr;
+                break;
+            case 's':
+                stats = true;
+                break;
+            case 'h':
+                usage(stdout);
+                return EXIT_SUCCESS;
+            default:
+                usage(stderr);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (u.count_mode) {
+        u.counted = strmap_new(&(struct StrMapSetup) {
+            .set.hasher = u.hasher,
+            .value_size = sizeof(struct Counted),
+        });
+    } else if (u.engine == E_hash64)
+        table_init(&u.table, 1024);
+    else
+        u.set = strset_new(&(struct StrSetSetup) { .hasher = u.hasher });
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double start = ts.tv_sec + ts.tv_nsec / 1e9;
+
+    int ret = EXIT_SUCCESS;
+    if (optind == argc)
+        argv[--optind] = "-";
+    for (int i = optind; i < argc; i++) {
+        bool ok = strcmp(argv[i], "-") ?
+            strset_file_each_line(argv[i], flags, on_line, &u) :
+            strset_fd_each_line(0, flags, on_line, &u);
+        if (!ok) {
+            perror(argv[i]);
+            ret = EXIT_FAILURE;
+        }
+    }
+
+    size_t unique = 0;
+    if (u.count_mode) {
+        unique = strmap_count(u.counted);
+        struct CountedKey *ordered = malloc(sizeof(ordered[0]) * (unique + 1));
+        assert(ordered);
+        strmap_each(u.counted, iter_counted, ordered);
+
+        char buf[32];
+        for (size_t i = 0; i < unique; i++) {
+            int len = snprintf(buf, sizeof(buf), "%7zu ", ordered[i].count);
+            if (out_used + len > OUT_BUF_SIZE)
+                out_flush();
+            memcpy(out_buf + out_used, buf, len);
+            out_used += len;
+            out_line(ordered[i].key, strlen(ordered[i].key));
+        }
+        free(ordered);
+    } else {
+        unique = u.set ? strset_count(u.set) : u.table.num;
+    }
+    out_flush();
+    fflush(stdout);
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double seconds = ts.tv_sec + ts.tv_nsec / 1e9 - start;
+    if (stats) {
+        fprintf(
+            stderr,
+            "strset_uniq: %s, %zu lines, %zu unique, %.3fs, %.1f MB/s\n",
+            u.engine == E_strset ? "strset" : "hash64",
+            u.lines, unique, seconds,
+            seconds > 0. ? u.bytes / seconds / (1024 * 1024) : 0.
+        );
+    }
+
+    if (u.set)
+        strset_free(u.set);
+    strmap_free(u.counted);
+    table_shutdown(&u.table);
+    return ret;
+}
@@ -0,0 +1,107 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strsym.h"
+
+#include "strset_table.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAMES_CAP_MIN   256
+
+struct Name {
+    const char  *str;
+    size_t      len;
+};
+
+struct StrSymtab {
+    // строка -> номер. Удалений нет, поэтому арена таблицы не
+    // пересобирается и ключи не переезжают.
+    StrTable    table;
+    struct Name *names;
+    uint32_t    names_num, names_cap;
+};
+
+StrSymtab *strsym_new(struct StrSetSetup *setup) {
+    StrSymtab *sym = calloc(1, sizeof(*sym));
+    assert(sym);
+    strtable_init(&sym->table, setup, sizeof(uint32_t));
+    return sym;
+}
+
+void strsym_free(StrSymtab *sym) {
+    if (!sym)
+        return;
+    strtable_shutdown(&sym->table);
+    free(sym->names);
+    free(sym);
+}
+
+void strsym_clear(StrSymtab *sym) {
+    assert(sym);
+    strtable_clear(&sym->table);
+    sym->names_num = 0;
+}
+
+static void names_push(StrSymtab *sym, const char *str, size_t len) {
+    if (sym->names_num == sym->names_cap) {
+        assert(sym->names_cap < UINT32_MAX / 2);
+        sym->names_cap = sym->names_cap ? sym->names_cap * 2 : NAMES_CAP_MIN;
+        sym->names = realloc(sym->names, sizeof(sym->names[0]) * sym->names_cap);
+        assert(sym->names);
+    }
+    sym->names[sym->names_num++] = (struct Name) {
+        .str = str,
+        .len = len,
+    };
+}
+
+const char *strsym_intern_len(
+    StrSymtab *sym, const char *key, size_t len, uint32_t *id
+) {
+    assert(sym);
+    assert(key);
+
+    bool inserted = false;
+    uint32_t *value = strtable_upsert(&sym->table, key, len, &inserted);
+    if (inserted) {
+        *value = sym->names_num;
+        // копия ключа в арене таблицы - единственная, ее и раздаем
+        names_push(sym, strtable_key(&sym->table, value), len);
+    }
+    if (id)
+        *id = *value;
+    return sym->names[*value].str;
+}
+
+const char *strsym_intern(StrSymtab *sym, const char *key, uint32_t *id) {
+    assert(key);
+    return strsym_intern_len(sym, key, strlen(key), id);
+}
+
+bool strsym_find(StrSymtab *sym, const char *key, uint32_t *id) {
+    assert(sym);
+    assert(key);
+    uint32_t *value = strtable_get(&sym->table, key, strlen(key));
+    if (value && id)
+        *id = *value;
+    return value;
+}
+
+const char *strsym_name(StrSymtab *sym, uint32_t id) {
+    assert(sym);
+    assert(id < sym->names_num);
+    return sym->names[id].str;
+}
+
+size_t strsym_name_len(StrSymtab *sym, uint32_t id) {
+    assert(sym);
+    assert(id < sym->names_num);
+    return sym->names[id].len;
+}
+
+uint32_t strsym_count(StrSymtab *sym) {
+    assert(sym);
+    return sym->names_num;
+}
@@ -0,0 +1,35 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_strset.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Таблица символов: каждая строка хранится один раз и получает плотный
+// номер 0, 1, 2... в порядке первого добавления. Одинаковые строки дают один
+// и тот же указатель, поэтому сравнивать можно указатели или номера вместо
+// strcmp(). Имя по номеру - индекс массива, без хэширования. Символы не
+// удаляются, указатели действительны до strsym_clear() или strsym_free().
+
+typedef struct StrSymtab StrSymtab;
+
+StrSymtab *strsym_new(struct StrSetSetup *setup);
+void strsym_free(StrSymtab *sym);
+// Забыть все символы, номера снова начинаются с 0
+void strsym_clear(StrSymtab *sym);
+// Канонический указатель строки, добавляет ее при первом вызове. id может
+// быть NULL.
+const char *strsym_intern(StrSymtab *sym, const char *key, uint32_t *id);
+// То же для len байт key без завершающего нуля
+const char *strsym_intern_len(
+    StrSymtab *sym, const char *key, size_t len, uint32_t *id
+);
+// Не добавляет, false если строки нет
+bool strsym_find(StrSymtab *sym, const char *key, uint32_t *id);
+const char *strsym_name(StrSymtab *sym, uint32_t id);
+// Длина имени без strlen()
+size_t strsym_name_len(StrSymtab *sym, uint32_t id);
+// Число символов, номера лежат в [0, count)
+uint32_t strsym_count(StrSymtab *sym);
@@ -0,0 +1,200 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+
+#include "strtopk.h"
+
+#include "strmap.h"
+#include "strset_io.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNTERS_DEFAULT    1024
+
+struct Node {
+    char        *key;
+    size_t      key_cap;
+    uint64_t    count, error;
+    // позиция в куче
+    size_t      pos;
+};
+
+struct StrTopK {
+    // ключ -> номер узла
+    StrMap      *index;
+    struct Node *nodes;
+    // номера узлов, куча по возрастанию count
+    size_t      *heap;
+    size_t      counters, num;
+    uint64_t    total;
+};
+
+// {{{ Куча
+
+static inline uint64_t heap_count(StrTopK *tk, size_t pos) {
+    return tk->nodes[tk->heap[pos]].count;
+}
+
+static inline void heap_swap(StrTopK *tk, size_t a, size_t b) {
+    size_t tmp = tk->heap[a];
+    tk->heap[a] = tk->heap[b];
+    tk->heap[b] = tmp;
+    tk->nodes[tk->heap[a]].pos = a;
+    tk->nodes[tk->heap[b]].pos = b;
+}
+
+static void heap_up(StrTopK *tk, size_t pos) {
+    while (pos) {
+        size_t parent = (pos - 1) / 2;
+        if (heap_count(tk, parent) <= heap_count(tk, pos))
+            break;
+        heap_swap(tk, parent, pos);
+        pos = parent;
+    }
+}
+
+static void heap_down(StrTopK *tk, size_t pos) {
+    for (;;) {
+        size_t least = pos, left = pos * 2 + 1, right = left + 1;
+        if (left < tk->num && heap_count(tk, left) < heap_count(tk, least))
+            least = left;
+        if (right < tk->num && heap_count(tk, right) < heap_count(tk, least))
+            least = right;
+        if (least == pos)
+            break;
+        heap_swap(tk, pos, least);
+        pos = least;
+    }
+}
+
+// }}}
+
+StrTopK *strtopk_new(struct StrTopKSetup *setup) {
+    StrTopK *tk = calloc(1, sizeof(*tk));
+    assert(tk);
+
+    tk->counters = setup && setup->counters ?
+        setup->counters : COUNTERS_DEFAULT;
+    tk->index = strmap_new(&(struct StrMapSetup) {
+        .set = {
+            .capacity = tk->counters,
+            .hasher = setup ? setup->hasher : NULL,
+        },
+        .value_size = sizeof(size_t),
+    });
+    tk->nodes = calloc(tk->counters, sizeof(tk->nodes[0]));
+    tk->heap = calloc(tk->counters, sizeof(tk->heap[0]));
+    assert(tk->nodes && tk->heap);
+    return tk;
+}
+
+void strtopk_free(StrTopK *tk) {
+    if (!tk)
+        return;
+    for (size_t i = 0; i < tk->counters; i++)
+        free(tk->nodes[i].key);
+    strmap_free(tk->index);
+    free(tk->nodes);
+    free(tk->heap);
+    free(tk);
+}
+
+void strtopk_clear(StrTopK *tk) {
+    assert(tk);
+    strmap_clear(tk->index);
+    tk->num = 0;
+    tk->total = 0;
+}
+
+static void node_key_set(struct Node *node, const char *key) {
+    size_t len = strlen(key) + 1;
+    if (node->key_cap < len) {
+        node->key = realloc(node->key, len);
+        assert(node->key);
+        node->key_cap = len;
+    }
+    memcpy(node->key, key, len);
+}
+
+void strtopk_add(StrTopK *tk, const char *key, uint64_t weight) {
+    assert(tk);
+    assert(key);
+
+    tk->total += weight;
+
+    bool inserted = false;
+    size_t *id = strmap_get_or_insert(tk->index, key, &inserted);
+    if (!inserted) {
+        struct Node *node = &tk->nodes[*id];
+        node->count += weight;
+        heap_down(tk, node->pos);
+        return;
+    }
+
+    if (tk->num < tk->counters) {
+        *id = tk->num;
+        struct Node *node = &tk->nodes[*id];
+        node_key_set(node, key);
+        node->count = weight;
+        node->error = 0;
+        node->pos = tk->num;
+        tk->heap[tk->num++] = *id;
+        heap_up(tk, node->pos);
+        return;
+    }
+
+    // вытеснить ключ с наименьшим счетчиком. Удаление из индекса может
+    // сдвинуть слоты, id берется заново.
+    size_t victim = tk->heap[0];
+    struct Node *node = &tk->nodes[victim];
+    strmap_remove(tk->index, node->key);
+    id = strmap_get(tk->index, key);
+    *id = victim;
+
+    node_key_set(node, key);
+    node->error = node->count;
+    node->count += weight;
+    heap_down(tk, 0);
+}
+
+static int cmp_items(const void *a, const void *b) {
+    const StrTopKItem *x = a, *y = b;
+    return x->count < y->count ? 1 : x->count > y->count ? -1 : 0;
+}
+
+size_t strtopk_list(StrTopK *tk, StrTopKItem *items, size_t items_num) {
+    assert(tk);
+    assert(items || !items_num);
+
+    StrTopKItem *all = malloc(sizeof(all[0]) * (tk->num + 1));
+    assert(all);
+    for (size_t i = 0; i < tk->num; i++) {
+        struct Node *node = &tk->nodes[tk->heap[i]];
+        all[i] = (StrTopKItem) {
+            .key = node->key,
+            .count = node->count,
+            .error = node->error,
+        };
+    }
+    qsort(all, tk->num, sizeof(all[0]), cmp_items);
+
+    size_t num = items_num < tk->num ? items_num : tk->num;
+    memcpy(items, all, sizeof(all[0]) * num);
+    free(all);
+    return num;
+}
+
+uint64_t strtopk_total(StrTopK *tk) {
+    assert(tk);
+    return tk->total;
+}
+
+static bool line_add(char *line, size_t len, void *udata) {
+    strtopk_add(udata, line, 1);
+    return true;
+}
+
+bool strtopk_add_file(StrTopK *tk, const char *path, uint32_t flags) {
+    assert(tk);
+    return strset_file_each_line(path, flags, line_add, tk);
+}
@@ -0,0 +1,40 @@
+// vim: set colorcolumn=85
+// vim: fdm=marker
+#pragma once
+
+#include "koh_hashers.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Самые частые ключи потока в ограниченной памяти (Space-Saving).
+// Отслеживается не больше counters ключей. Новый ключ при заполнении
+// вытесняет ключ с наименьшим счетчиком и наследует его значение как
+// ошибку. Для каждого ключа в списке настоящее число повторов лежит в
+// [count - error, count]. Любой ключ, встретившийся больше total / counters
+// раз, гарантированно в списке.
+
+struct StrTopKSetup {
+    // 0 - 1024
+    size_t          counters;
+    HashFunction    hasher;
+};
+
+typedef struct StrTopKItem {
+    // действителен до следующего изменения StrTopK
+    const char  *key;
+    uint64_t    count, error;
+} StrTopKItem;
+
+typedef struct StrTopK StrTopK;
+
+StrTopK *strtopk_new(struct StrTopKSetup *setup);
+void strtopk_free(StrTopK *tk);
+void strtopk_clear(StrTopK *tk);
+void strtopk_add(StrTopK *tk, const char *key, uint64_t weight);
+// До items_num самых частых ключей по убыванию count, возвращает число
+size_t strtopk_list(StrTopK *tk, StrTopKItem *items, size_t items_num);
+// Сумма весов всех добавленных ключей
+uint64_t strtopk_total(StrTopK *tk);
+// Каждая строка файла с весом 1, flags - StrSetReadFlags из strset_io.h
+bool strtopk_add_file(StrTopK *tk, const char *path, uint32_t flags);